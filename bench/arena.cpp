@@ -0,0 +1,82 @@
+// Building and dropping a recursive expression tree in an arena, against
+// the same tree allocated node by node on the heap.
+//   bench_arena [leaves]
+#include "bench.hpp"
+
+#include <tagged_union/arena.hpp>
+#include <memory>
+#include <utility>
+
+struct Expr {
+  TAGGED_UNION(Expr,
+	       (NUM, double, num),
+	       (ADD, std::pair<tagged_union::arena_ptr<Expr>, tagged_union::arena_ptr<Expr>>, add))
+
+  double eval() const {
+    return get_type() == NUM ? num() : add().first->eval() + add().second->eval();
+  }
+};
+
+tagged_union::arena_ptr<Expr> build(tagged_union::arena& a, std::size_t lo, std::size_t hi) {
+  if (lo == hi)
+    return a.make<Expr>(Expr::create<Expr::NUM>(double(lo)));
+  std::size_t const mid = lo + (hi - lo) / 2;
+  auto const left = build(a, lo, mid);
+  auto const right = build(a, mid + 1, hi);
+  return a.make<Expr>(Expr::create<Expr::ADD>(std::make_pair(left, right)));
+}
+
+// The same tree with one new/delete per node, as with owning child pointers
+tagged_union::arena_ptr<Expr> build_heap(std::size_t lo, std::size_t hi) {
+  if (lo == hi)
+    return tagged_union::arena_ptr<Expr>(new Expr(Expr::create<Expr::NUM>(double(lo))));
+  std::size_t const mid = lo + (hi - lo) / 2;
+  auto const left = build_heap(lo, mid);
+  auto const right = build_heap(mid + 1, hi);
+  return tagged_union::arena_ptr<Expr>(new Expr(Expr::create<Expr::ADD>(std::make_pair(left, right))));
+}
+
+void drop_heap(tagged_union::arena_ptr<Expr> node) {
+  if (node->get_type() == Expr::ADD) {
+    drop_heap(node->add().first);
+    drop_heap(node->add().second);
+  }
+  delete node.get();
+}
+
+int main(int argc, char** argv) {
+  std::size_t const leaves = bench::arg(argc, argv, 1, 1'000'000);
+  std::size_t const nodes = 2 * leaves - 1;
+  int const runs = 5;
+  std::printf("%zu nodes (best of %d)\n", nodes, runs);
+
+  // Build and drop are timed separately, so each run does both by hand
+  double arena_build = 1e300, arena_drop = 1e300, heap_build = 1e300, heap_drop = 1e300;
+  for (int r = 0; r < runs; ++r) {
+    auto start = bench::clock::now();
+    auto a = std::make_unique<tagged_union::arena>();
+    auto const root = build(*a, 1, leaves);
+    auto mid = bench::clock::now();
+    bench::keep(root->eval());
+    auto const before_drop = bench::clock::now();
+    a.reset();
+    auto end = bench::clock::now();
+    arena_build = std::min(arena_build, std::chrono::duration<double>(mid - start).count());
+    arena_drop = std::min(arena_drop, std::chrono::duration<double>(end - before_drop).count());
+
+    start = bench::clock::now();
+    auto const heap = build_heap(1, leaves);
+    mid = bench::clock::now();
+    bench::keep(heap->eval());
+    auto const heap_before_drop = bench::clock::now();
+    drop_heap(heap);
+    end = bench::clock::now();
+    heap_build = std::min(heap_build, std::chrono::duration<double>(mid - start).count());
+    heap_drop = std::min(heap_drop, std::chrono::duration<double>(end - heap_before_drop).count());
+  }
+
+  bench::row("arena build", arena_build, arena_build / nodes * 1e9, "ns/node");
+  bench::row("new/delete build", heap_build, heap_build / nodes * 1e9, "ns/node");
+  bench::row("arena drop", arena_drop, arena_drop / nodes * 1e9, "ns/node");
+  bench::row("new/delete drop", heap_drop, heap_drop / nodes * 1e9, "ns/node");
+}
@@ -0,0 +1,45 @@
+#ifndef TAGGED_UNION_BENCH_H
+#define TAGGED_UNION_BENCH_H
+
+// Minimal timing helpers shared by the benchmarks in this directory
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace bench {
+  using clock = std::chrono::steady_clock;
+
+  // Best of `runs` wall-clock times of fn(), in seconds. The minimum is the
+  // least noisy estimate on a machine that is doing other things too.
+  template <typename Fn>
+  double best_of(int runs, Fn&& fn) {
+    double best = 1e300;
+    for (int r = 0; r < runs; ++r) {
+      auto const start = clock::now();
+      fn();
+      std::chrono::duration<double> const elapsed = clock::now() - start;
+      best = std::min(best, elapsed.count());
+    }
+    return best;
+  }
+
+  // Keeps the optimizer from discarding a result
+  template <typename T>
+  void keep(T const& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+  }
+
+  // argv[index] as a number, or fallback when it's missing
+  inline unsigned long arg(int argc, char** argv, int index, unsigned long fallback) {
+    return index < argc ? std::strtoul(argv[index], nullptr, 10) : fallback;
+  }
+
+  inline void row(std::string const& name, double seconds, double per, char const* unit) {
+    std::printf("  %-34s %10.3f ms %12.1f %s\n", name.c_str(), seconds * 1e3, per, unit);
+  }
+}
+
+#endif // TAGGED_UNION_BENCH_H
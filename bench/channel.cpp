@@ -0,0 +1,148 @@
+// tagged_union::channel against a mutex-guarded std::deque: throughput with
+// 1 to N producers, and round-trip latency between two threads.
+//   bench_channel [messages] [max producers]
+#include "bench.hpp"
+
+#include <tagged_union/channel.hpp>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Message {
+  TAGGED_UNION(Message,
+	       (VALUE, std::size_t, value),
+	       (TEXT, std::string, text),
+	       (STOP, void, void))
+};
+
+Message make_message(std::size_t i) {
+  if (i % 8 == 0)
+    return Message::create<Message::TEXT>("text");
+  return Message::create<Message::VALUE>(i);
+}
+
+// The obvious alternative, with the same interface as the parts of
+// channel used here. It's unbounded, so the capacity is ignored.
+class locked_queue {
+public:
+  explicit locked_queue(std::size_t /* capacity */) {}
+
+  bool try_push(Message&& message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(std::move(message));
+    return true;
+  }
+  std::optional<Message> try_pop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (queue.empty())
+      return std::nullopt;
+    std::optional<Message> out(std::move(queue.front()));
+    queue.pop_front();
+    return out;
+  }
+
+private:
+  std::mutex mutex;
+  std::deque<Message> queue;
+};
+
+// producers threads push per_producer messages each, one at a time; the
+// calling thread pops them one at a time (or drains in batches)
+template <typename Queue>
+double throughput(Queue& queue, unsigned producers, std::size_t per_producer, bool batched) {
+  return bench::best_of(3, [&] {
+    std::vector<std::thread> threads;
+    for (unsigned p = 0; p < producers; ++p)
+      threads.emplace_back([&] {
+	for (std::size_t i = 0; i < per_producer; ++i)
+	  while (!queue.try_push(make_message(i)))
+	    std::this_thread::yield();
+      });
+
+    std::size_t received = 0, sum = 0;
+    auto const value = [&](std::size_t v) { sum += v; ++received; };
+    auto const text = [&](std::string const& t) { sum += t.size(); ++received; };
+    while (received < producers * per_producer) {
+      std::size_t got = 0;
+      if constexpr (!std::is_same_v<Queue, locked_queue>) {
+	if (batched)
+	  got = queue.drain(value, text, [] {});
+      }
+      if (!batched) {
+	if (auto m = queue.try_pop()) {
+	  m->visit(::tagged_union::overloaded{value, text, [] {}});
+	  got = 1;
+	}
+      }
+      if (!got)
+	std::this_thread::yield();
+    }
+    for (auto& t : threads)
+      t.join();
+    bench::keep(sum);
+  });
+}
+
+// Ping-pong between two threads through a pair of queues
+template <typename Queue>
+double round_trip(std::size_t trips) {
+  Queue there(64), back(64);
+  return bench::best_of(3, [&] {
+    std::thread echo([&] {
+      for (std::size_t i = 0; i < trips; ++i) {
+	std::optional<Message> m;
+	while (!(m = there.try_pop()))
+	  std::this_thread::yield();
+	while (!back.try_push(std::move(*m)))
+	  std::this_thread::yield();
+      }
+    });
+    for (std::size_t i = 0; i < trips; ++i) {
+      while (!there.try_push(make_message(i)))
+	std::this_thread::yield();
+      std::optional<Message> m;
+      while (!(m = back.try_pop()))
+	std::this_thread::yield();
+    }
+    echo.join();
+  });
+}
+
+int main(int argc, char** argv) {
+  std::size_t const messages = bench::arg(argc, argv, 1, 1'000'000);
+  unsigned const hw = std::max(2u, std::thread::hardware_concurrency());
+  unsigned const max_producers = unsigned(bench::arg(argc, argv, 2, hw - 1));
+  std::printf("%zu messages per run, 1 to %u producers (best of 3)\n", messages, max_producers);
+
+  for (unsigned producers = 1; producers <= max_producers; ++producers) {
+    std::size_t const per_producer = messages / producers;
+    std::size_t const total = per_producer * producers;
+    std::printf("%u producer%s:\n", producers, producers == 1 ? "" : "s");
+
+    if (producers == 1) {
+      tagged_union::channel<Message> spsc(1024);
+      double const t = throughput(spsc, 1, per_producer, false);
+      bench::row("channel<single> try_pop", t, total / t / 1e6, "M msg/s");
+      double const batched = throughput(spsc, 1, per_producer, true);
+      bench::row("channel<single> drain", batched, total / batched / 1e6, "M msg/s");
+    }
+    tagged_union::channel<Message, tagged_union::producers::multi> mpsc(1024);
+    double const t = throughput(mpsc, producers, per_producer, false);
+    bench::row("channel<multi> try_pop", t, total / t / 1e6, "M msg/s");
+    double const batched = throughput(mpsc, producers, per_producer, true);
+    bench::row("channel<multi> drain", batched, total / batched / 1e6, "M msg/s");
+    locked_queue locked(1024);
+    double const l = throughput(locked, producers, per_producer, false);
+    bench::row("mutex + std::deque", l, total / l / 1e6, "M msg/s");
+  }
+
+  std::size_t const trips = std::max<std::size_t>(1, messages / 20);
+  std::printf("round trips (%zu):\n", trips);
+  double const spsc = round_trip<tagged_union::channel<Message>>(trips);
+  bench::row("channel<single>", spsc, spsc / trips * 1e9, "ns/trip");
+  double const locked = round_trip<locked_queue>(trips);
+  bench::row("mutex + std::deque", locked, locked / trips * 1e9, "ns/trip");
+}
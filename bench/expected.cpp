@@ -0,0 +1,100 @@
+// Error propagation through a chain of calls: tagged_union::expected with
+// TAGGED_UNION_TRY, against exceptions and std::variant, at several
+// failure rates.
+//   bench_expected [calls]
+#include "bench.hpp"
+
+#include <tagged_union/expected.hpp>
+#include <variant>
+
+constexpr int depth = 8;
+
+struct parse_error {
+  unsigned code;
+};
+
+// Fails for roughly permille/1000 of the inputs
+inline bool fails(unsigned x, unsigned permille) {
+  return (x * 2654435761u >> 8) % 1000 < permille;
+}
+
+// == expected ==
+using Result = tagged_union::expected<unsigned, parse_error>;
+
+template <int N>
+BOOST_NOINLINE Result with_expected(unsigned x, unsigned permille) {
+  if constexpr (N == 0) {
+    if (fails(x, permille))
+      return tagged_union::unexpected<parse_error>{{x}};
+    return x * 3;
+  } else {
+    TAGGED_UNION_TRY(unsigned value, with_expected<N - 1>(x, permille));
+    return value + 1;
+  }
+}
+
+// == exceptions ==
+template <int N>
+BOOST_NOINLINE unsigned with_exceptions(unsigned x, unsigned permille) {
+  if constexpr (N == 0) {
+    if (fails(x, permille))
+      throw parse_error{x};
+    return x * 3;
+  } else {
+    return with_exceptions<N - 1>(x, permille) + 1;
+  }
+}
+
+// == std::variant ==
+using Variant = std::variant<unsigned, parse_error>;
+
+template <int N>
+BOOST_NOINLINE Variant with_variant(unsigned x, unsigned permille) {
+  if constexpr (N == 0) {
+    if (fails(x, permille))
+      return parse_error{x};
+    return x * 3;
+  } else {
+    Variant inner = with_variant<N - 1>(x, permille);
+    if (auto const* value = std::get_if<unsigned>(&inner))
+      return *value + 1;
+    return inner;
+  }
+}
+
+int main(int argc, char** argv) {
+  unsigned const calls = unsigned(bench::arg(argc, argv, 1, 1'000'000));
+  int const runs = 5;
+  std::printf("%u calls through %d frames (best of %d)\n", calls, depth, runs);
+  std::printf("sizeof: expected %zu, std::variant %zu\n", sizeof(Result), sizeof(Variant));
+
+  for (unsigned permille : {0u, 1u, 10u, 100u, 500u}) {
+    std::printf("%.1f%% failures:\n", permille / 10.0);
+    unsigned long sum = 0;
+    double const expected_time = bench::best_of(runs, [&] {
+      for (unsigned i = 0; i < calls; ++i) {
+	Result r = with_expected<depth>(i, permille);
+	sum += r ? r.value() : r.error().code;
+      }
+    });
+    double const exception_time = bench::best_of(runs, [&] {
+      for (unsigned i = 0; i < calls; ++i) {
+	try {
+	  sum += with_exceptions<depth>(i, permille);
+	} catch (parse_error const& e) {
+	  sum += e.code;
+	}
+      }
+    });
+    double const variant_time = bench::best_of(runs, [&] {
+      for (unsigned i = 0; i < calls; ++i) {
+	Variant v = with_variant<depth>(i, permille);
+	sum += v.index() == 0 ? std::get<0>(v) : std::get<1>(v).code;
+      }
+    });
+    bench::keep(sum);
+    bench::row("tagged_union::expected", expected_time, expected_time / calls * 1e9, "ns/call");
+    bench::row("exceptions", exception_time, exception_time / calls * 1e9, "ns/call");
+    bench::row("std::variant", variant_time, variant_time / calls * 1e9, "ns/call");
+  }
+}
@@ -0,0 +1,71 @@
+// Scaling of the tagged_union/parallel.hpp algorithms from 1 to N threads.
+//   bench_parallel [elements] [max threads]
+#include "bench.hpp"
+
+#include <tagged_union/parallel.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Sample {
+  TAGGED_UNION(Sample,
+	       (SMALL, int, small),
+	       (LARGE, long, large),
+	       (LABEL, std::string, label),
+	       (MISSING, void, void))
+};
+
+std::vector<Sample> make_samples(std::size_t n) {
+  std::vector<Sample> samples;
+  samples.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    switch ((i * 2654435761u) % 4) { // Shuffled, so that branches mispredict like real data
+    case 0: samples.push_back(Sample::create<Sample::SMALL>(int(i))); break;
+    case 1: samples.push_back(Sample::create<Sample::LARGE>(long(i))); break;
+    case 2: samples.push_back(Sample::create<Sample::LABEL>("label")); break;
+    default: samples.push_back(Sample::create<Sample::MISSING>()); break;
+    }
+  }
+  return samples;
+}
+
+int main(int argc, char** argv) {
+  namespace par = tagged_union::parallel;
+  std::size_t const n = bench::arg(argc, argv, 1, 4'000'000);
+  unsigned const hw = std::max(1u, std::thread::hardware_concurrency());
+  unsigned const max_threads = unsigned(bench::arg(argc, argv, 2, hw));
+  int const runs = 5;
+
+  auto samples = make_samples(n);
+  std::printf("%zu elements, 1 to %u threads (best of %d)\n", n, max_threads, runs);
+
+  double base[4] = {};
+  for (unsigned threads = 1; threads <= max_threads; ++threads) {
+    par::policy const policy{threads, 0};
+    double const times[] = {
+      bench::best_of(runs, [&] {
+	par::for_each_variant(policy, samples,
+			      [](int& i) { i += 1; },
+			      [](long& l) { l -= 1; },
+			      [](std::string&) {},
+			      [] {});
+      }),
+      bench::best_of(runs, [&] {
+	bench::keep(par::reduce_by_type(policy, samples, 0.0, std::plus<>(),
+					[](auto const& x) { return double(x); },
+					[](std::string const& s) { return double(s.size()); },
+					[] { return 0.0; }));
+      }),
+      bench::best_of(runs, [&] { bench::keep(par::count_by_type(samples, policy)); }),
+      bench::best_of(runs, [&] { bench::keep(par::partition_by_type(samples, Sample::LABEL, policy)); }),
+    };
+    char const* const names[] = {"for_each_variant", "reduce_by_type", "count_by_type", "partition_by_type"};
+
+    std::printf("%u thread%s:\n", threads, threads == 1 ? "" : "s");
+    for (int i = 0; i < 4; ++i) {
+      if (threads == 1)
+	base[i] = times[i];
+      bench::row(names[i], times[i], base[i] / times[i], "x speedup");
+    }
+  }
+}
@@ -4,6 +4,8 @@
 #include <type_traits>
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <string_view>
 #include <utility>
 
 #include <boost/version.hpp>
@@ -20,6 +22,7 @@
 #include <boost/preprocessor/facilities/empty.hpp>
 #include <boost/preprocessor/facilities/is_empty.hpp>
 #include <boost/preprocessor/punctuation/comma.hpp>
+#include <boost/preprocessor/stringize.hpp>
 #include <boost/preprocessor/seq/elem.hpp>
 #include <boost/preprocessor/seq/enum.hpp>
 #include <boost/preprocessor/seq/for_each.hpp>
@@ -29,6 +32,7 @@
 #include <boost/preprocessor/tuple/elem.hpp>
 #include <boost/preprocessor/tuple/remove.hpp>
 #include <boost/preprocessor/tuple/to_seq.hpp>
+#include <boost/preprocessor/variadic/size.hpp>
 #include <boost/preprocessor/variadic/to_seq.hpp>
   
 // C++23: brings std::unreachable, but that doesn't work
@@ -140,6 +144,83 @@ namespace tagged_union::detail {
 
   template <typename... Ts>
   static constexpr bool UseNoexceptAssigner = (... && std::is_nothrow_move_assignable_v<Ts>);
+
+  // Every type is trivially copyable, so copies/moves of the whole
+  // storage are just a memcpy regardless of which variant is active
+  template <typename... Ts>
+  static constexpr bool UseTrivialCopy = (... && std::is_trivially_copyable_v<Ts>);
+
+  // Visitors may either take the tag (as an OfType<...>) followed by the
+  // payload, or just the payload. The former is required to tell apart
+  // multiple variants of the same type.
+  template <typename F, typename Tag, typename Data>
+  BOOST_FORCEINLINE constexpr decltype(auto) invoke_variant(F&& f, Tag tag, Data&& data) {
+    if constexpr (std::is_invocable_v<F, Tag, Data>)
+      return std::forward<F>(f)(tag, std::forward<Data>(data));
+    else
+      return std::forward<F>(f)(std::forward<Data>(data));
+  }
+
+  // Void variants are visited with f(tag) only when f has an overload
+  // written for that tag, and with f() otherwise. A generic one-argument
+  // handler ([](auto const& x) {...}) is meant for payloads, so it must
+  // never be handed a tag.
+  //
+  // To tell the two apart without instantiating generic bodies (which
+  // would be a hard error rather than SFINAE), TagProbe adds a catch-all
+  // overload to f's and calls it with a const tag lvalue. A non-template
+  // tag overload beats the catch-all; a generic overload is either
+  // ambiguous with it (auto const&) or less specialized (auto&&, auto&).
+  // Either way, only a real tag overload is ever selected. The catch-all
+  // has to match the constness of f's operators to compete with them, so
+  // const and non-const (mutable) operators are probed separately.
+  struct NoTagOverload {};
+  template <typename F, bool Const>
+  struct TagProbe : F {
+    using F::operator();
+    template <typename Arg> NoTagOverload operator()(Arg const&) const;
+  };
+  template <typename F>
+  struct TagProbe<F, false> : F {
+    using F::operator();
+    template <typename Arg> NoTagOverload operator()(Arg const&);
+  };
+  template <typename Probe, typename Tag, typename = void>
+  struct ProbeTagOverload : std::false_type {};
+  template <typename Probe, typename Tag>
+  struct ProbeTagOverload<Probe, Tag, std::void_t<decltype(std::declval<Probe&>()(std::declval<Tag const&>()))>>
+    : std::bool_constant<!std::is_same_v<decltype(std::declval<Probe&>()(std::declval<Tag const&>())),
+					 NoTagOverload>> {};
+
+  template <typename F, typename Tag>
+  static constexpr bool HasTagOverload = [] {
+    using Base = std::remove_cv_t<std::remove_reference_t<F>>;
+    if constexpr (std::is_class_v<Base> && !std::is_final_v<Base>) {
+      return ProbeTagOverload<TagProbe<Base, true> const, Tag>::value
+	|| (!std::is_const_v<std::remove_reference_t<F>>
+	    && ProbeTagOverload<TagProbe<Base, false>, Tag>::value);
+    } else {
+      // Plain functions can't be generic
+      return std::is_invocable_v<F, Tag>;
+    }
+  }();
+
+  template <typename F, typename Tag>
+  BOOST_FORCEINLINE constexpr decltype(auto) invoke_void_variant(F&& f, Tag tag) {
+    if constexpr (HasTagOverload<F, Tag>)
+      return std::forward<F>(f)(tag);
+    else
+      return std::forward<F>(f)();
+  }
+}
+
+namespace tagged_union {
+  // The usual lambda overload set, for use with visit():
+  //   u.visit(tagged_union::overloaded{[](int i) {...}, [](float f) {...}});
+  template <typename... Fs>
+  struct overloaded : Fs... { using Fs::operator()...; };
+  template <typename... Fs>
+  overloaded(Fs...) -> overloaded<Fs...>;
 }
 
 /*     TAGGED_UNION_IMPLEMENTATION     */
@@ -185,6 +266,18 @@ namespace tagged_union::detail {
   BOOST_PP_SEQ_FOR_EACH(fn, data, TAGGED_UNION_VARIADIC_TO_TRIPLETS(triplets))
 #define TAGGED_UNION_ENUM_FROM_TRIPLET(r, data, triplet)	\
   TAGGED_UNION_TAGNAME(triplet),
+#define TAGGED_UNION_TAGNAME_STRING_FROM_TRIPLET(r, data, triplet)	\
+  BOOST_PP_STRINGIZE(TAGGED_UNION_TAGNAME(triplet)),
+#define TAGGED_UNION_FIELDNAME_STRING_FROM_TRIPLET(r, data, triplet)	\
+  BOOST_PP_IF								\
+  (TAGGED_UNION_TUPLETYPE_IS_VOID(triplet),				\
+   "",									\
+   BOOST_PP_STRINGIZE(TAGGED_UNION_FIELDNAME(triplet))),
+#define TAGGED_UNION_PAYLOAD_FROM_TRIPLET(r, data, triplet)		\
+  template<bool DummyDefer>						\
+  struct PayloadImpl<TAGGED_UNION_TAGNAME(triplet), DummyDefer> {	\
+    using type = TAGGED_UNION_TUPLETYPE(triplet);			\
+  };
 #define TAGGED_UNION_MAX_VARIANT_ENUM(triplets)				\
   TAGGED_UNION_TAGNAME(BOOST_PP_SEQ_HEAD(BOOST_PP_SEQ_REVERSE(triplets)))
 #define TAGGED_UNION_TYPE_PACK_FROM_TRIPLET(r, data, triplet)	\
@@ -251,8 +344,8 @@ namespace tagged_union::detail {
    (TAGGED_UNION_TUPLETYPE_IS_VOID(triplet),				\
     (/* emit nothing if void... we don't even need to print the case label*/), \
     (case (TAGGED_UNION_TAGNAME(triplet)				\
-	   + std::is_trivially_destructible_v<TAGGED_UNION_TUPLETYPE(triplet)> \
-	   ? max_val+1 : 0):						\
+	   + (std::is_trivially_destructible_v<TAGGED_UNION_TUPLETYPE(triplet)> \
+	      ? max_val+1 : 0)):					\
      if constexpr(std::is_trivially_destructible_v<TAGGED_UNION_TUPLETYPE(triplet)>) { \
        /* We want to signal to the compiler that this path will never */ \
        /* be taken for optimization purposes. However, if we include */	\
@@ -330,8 +423,19 @@ namespace tagged_union::detail {
      noexcept(::tagged_union::detail::UseNoexceptMoveConstructor<TAGGED_UNION_TUPLETYPE(triplet)>) \
      : storage{								\
        TAGGED_UNION_TAGNAME(triplet) BOOST_PP_COMMA()			\
-	 AttrUnion {.TAGGED_UNION_FIELDNAME(triplet) = std::move(value)} \
+	 AttrUnion {.TAGGED_UNION_FIELDNAME(triplet) = std::forward<DummyDeffer>(value)} \
      } {})))
+#define TAGGED_UNION_VISIT_CASE_FROM_TRIPLET(r, data, triplet)	\
+  case TAGGED_UNION_TAGNAME(triplet):					\
+  __TAGGED_UNION_STRIP_PARENS						\
+  (BOOST_PP_IF								\
+   (TAGGED_UNION_TUPLETYPE_IS_VOID(triplet),				\
+    (return ::tagged_union::detail::invoke_void_variant		\
+     (std::forward<F>(f), OfType<TAGGED_UNION_TAGNAME(triplet)>());),	\
+    (return ::tagged_union::detail::invoke_variant			\
+     (std::forward<F>(f),						\
+      OfType<TAGGED_UNION_TAGNAME(triplet)>(),				\
+      storage.attr.TAGGED_UNION_FIELDNAME(triplet));)))
 #define TAGGED_UNION_ATTREQ_FROM_TRIPLET(r, data, triplet)	\
   case TAGGED_UNION_TAGNAME(triplet):				\
   BOOST_PP_IF							\
@@ -340,11 +444,33 @@ namespace tagged_union::detail {
    return storage.attr.TAGGED_UNION_FIELDNAME(triplet)		\
    == other.storage.attr.TAGGED_UNION_FIELDNAME(triplet));
 #define TAGGED_UNION(struct_name, triplets...)				\
+  TAGGED_UNION_IMPL(struct_name, /* default tag type */, triplets)
+/* Same as TAGGED_UNION, with an explicit underlying type for the tag, */
+/* E.g. unsigned char to keep the tag to a single byte */
+#define TAGGED_UNION_WITH_TAG_TYPE(struct_name, tag_type, triplets...)	\
+  TAGGED_UNION_IMPL(struct_name, : tag_type, triplets)
+#define TAGGED_UNION_IMPL(struct_name, enum_base, triplets...)		\
   public:								\
   using ThisType = struct_name;						\
-  enum Type {								\
+  enum Type enum_base {							\
     TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_ENUM_FROM_TRIPLET, _, triplets) \
   };									\
+  static constexpr std::size_t type_count =				\
+    BOOST_PP_VARIADIC_SIZE(triplets);					\
+  /* Names straight from the triplets, indexed by Type. */		\
+  /* Void variants have an empty field name. */				\
+  static constexpr std::string_view type_names[] = {			\
+    TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_TAGNAME_STRING_FROM_TRIPLET, _, triplets) \
+  };									\
+  static constexpr std::string_view field_names[] = {			\
+    TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_FIELDNAME_STRING_FROM_TRIPLET, _, triplets) \
+  };									\
+  /* payload_t<TAG> is the variant type of TAG (void if void) */	\
+  template <Type Tag, bool DummyDefer = true>				\
+  struct PayloadImpl;							\
+  TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_PAYLOAD_FROM_TRIPLET, _, triplets) \
+  template <Type Tag>							\
+  using payload_t = typename PayloadImpl<Tag>::type;			\
 									\
   /* We need several layers of indirection here */			\
   /* The core issue is that we want to specify an explicitly empty */	\
@@ -395,7 +521,10 @@ namespace tagged_union::detail {
       noexcept(::tagged_union::detail::UseNoexceptDestructor<		\
   	       TAGGED_UNION_TYPENAME_LIST(triplets)>) {			\
       auto constexpr max_val = TAGGED_UNION_MAX_VARIANT_ENUM(BOOST_PP_VARIADIC_TO_SEQ(triplets)); \
-      switch(type) {							\
+      /* Trivially destructible variants get case labels past the */	\
+      /* last enumerator, so switch on the underlying type to keep */	\
+      /* -Wswitch from flagging them. */				\
+      switch(static_cast<std::underlying_type_t<Type>>(type)) {		\
   	TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_DTOR_SWITCH_FROM_TRIPLET, _, triplets) \
       default:;								\
       }									\
@@ -410,11 +539,34 @@ namespace tagged_union::detail {
   constexpr Type const& get_type() const BOOST_NOEXCEPT {		\
     return storage.type;						\
   }									\
+  static constexpr std::string_view type_name(Type type) BOOST_NOEXCEPT { \
+    return type_names[type];						\
+  }									\
+  constexpr std::string_view type_name() const BOOST_NOEXCEPT {		\
+    return type_names[storage.type];					\
+  }									\
   template<Type T>							\
   struct OfType { static constexpr Type type = T; };			\
   constexpr void check_type(Type const& expected_type) const {		\
     assert(storage.type == expected_type);				\
   }									\
+  /* Calls f(OfType<tag>(), data) or f(data) for the active variant */	\
+  /* (void variants get f(OfType<tag>()) if f has an overload for */	\
+  /* that tag, or f()). All cases need to return the same type. */	\
+  template<typename F>							\
+  constexpr decltype(auto) visit(F&& f) {				\
+    switch(storage.type) {						\
+      TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_VISIT_CASE_FROM_TRIPLET, _, triplets) \
+    }									\
+    __TAGGED_UNION_UNREACHABLE();					\
+  }									\
+  template<typename F>							\
+  constexpr decltype(auto) visit(F&& f) const {				\
+    switch(storage.type) {						\
+      TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_VISIT_CASE_FROM_TRIPLET, _, triplets) \
+    }									\
+    __TAGGED_UNION_UNREACHABLE();					\
+  }									\
   /* So, C++ handles aggregate status... weirdly. */			\
   /* In C++17, the correct thing to do is delete the default */		\
   /* constructor, so that we can use non-trivial types as variants. */	\
@@ -428,30 +580,54 @@ namespace tagged_union::detail {
   /* but because AttrUnion isn't copy/move constructable it will  */	\
   /* be ignored. Thus, we need to define them manually.           */	\
   /* Similar logic applies to the others... SFINAE time           */	\
+  /*                                                              */	\
+  /* When every variant is trivially copyable, we copy the whole  */	\
+  /* Storage at once instead of switching on the type, which lets */	\
+  /* these lower to a plain memcpy. The helpers are templates     */	\
+  /* over the Storage type (like DummyDefer elsewhere) so that    */	\
+  /* the trivial branch depends on a template parameter, and is   */	\
+  /* really discarded for every other union.                      */	\
+  template <bool Trivial = ::tagged_union::detail::UseTrivialCopy<TAGGED_UNION_TYPENAME_LIST(triplets)>, \
+	    typename DeferredStorage = Storage>				\
+  static constexpr DeferredStorage init_storage_from(DeferredStorage const& other) BOOST_NOEXCEPT { \
+    if constexpr (Trivial)						\
+      return other;							\
+    else								\
+      return DeferredStorage{						\
+	.type = other.type,						\
+	  .attr = /* Deffer */AttrUnion{.__empty = {}}			\
+      };								\
+  }									\
+  template <bool Trivial = ::tagged_union::detail::UseTrivialCopy<TAGGED_UNION_TYPENAME_LIST(triplets)>, \
+	    typename DeferredStorage = Storage>				\
+  constexpr void assign_storage_from(DeferredStorage const& other) BOOST_NOEXCEPT { \
+    if constexpr (Trivial)						\
+      storage = other;							\
+  }									\
   struct_name(std::enable_if_t<::tagged_union::detail::UseCopyConstructor<TAGGED_UNION_TYPENAME_LIST(triplets)>, struct_name> const& other) noexcept \
     (::tagged_union::detail::UseNoexceptCopyConstructor<TAGGED_UNION_TYPENAME_LIST(triplets)>) \
-    : storage(Storage{							\
-  	.type = other.storage.type,					\
-  	  .attr = /* Deffer */AttrUnion{.__empty = {}}			\
-      }) {								\
-    switch (storage.type) {						\
-      TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_COPY_CONS_CASE_FROM_TRIPLET, _, triplets); \
+    : storage(init_storage_from(other.storage)) {			\
+    if constexpr (!::tagged_union::detail::UseTrivialCopy<TAGGED_UNION_TYPENAME_LIST(triplets)>) { \
+      switch (storage.type) {						\
+	TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_COPY_CONS_CASE_FROM_TRIPLET, _, triplets); \
+      }									\
     }									\
   }									\
   struct_name(std::enable_if_t<::tagged_union::detail::UseMoveConstructor<TAGGED_UNION_TYPENAME_LIST(triplets)>, struct_name>&& other) noexcept \
     (::tagged_union::detail::UseNoexceptMoveConstructor<TAGGED_UNION_TYPENAME_LIST(triplets)>) \
-    : storage(Storage{							\
-  	.type = std::move(other.storage.type),				\
-  	  .attr = /* Deffer */AttrUnion{.__empty = {}}			\
-      }) {								\
-    switch (storage.type) {						\
-      TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_MOVE_CONS_CASE_FROM_TRIPLET, _, triplets); \
+    : storage(init_storage_from(other.storage)) {			\
+    if constexpr (!::tagged_union::detail::UseTrivialCopy<TAGGED_UNION_TYPENAME_LIST(triplets)>) { \
+      switch (storage.type) {						\
+	TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_MOVE_CONS_CASE_FROM_TRIPLET, _, triplets); \
+      }									\
     }									\
   }									\
   std::enable_if_t<::tagged_union::detail::UseCopyAssigner<TAGGED_UNION_TYPENAME_LIST(triplets)>, struct_name>& operator=(struct_name const& other) \
     noexcept								\
     (::tagged_union::detail::UseNoexceptCopyAssigner<TAGGED_UNION_TYPENAME_LIST(triplets)>){ \
-    if (storage.type == other.storage.type) {				\
+    if constexpr (::tagged_union::detail::UseTrivialCopy<TAGGED_UNION_TYPENAME_LIST(triplets)>) { \
+      assign_storage_from(other.storage);				\
+    } else if (storage.type == other.storage.type) {			\
       /* In-place assignment*/						\
       switch(storage.type) {						\
 	TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_COPY_ASSGN_CASE_FROM_TRIPLET, _, triplets); \
@@ -465,7 +641,9 @@ namespace tagged_union::detail {
   }									\
   std::enable_if_t<::tagged_union::detail::UseMoveAssigner<TAGGED_UNION_TYPENAME_LIST(triplets)>, struct_name>& operator=(struct_name&& other) noexcept \
     (::tagged_union::detail::UseNoexceptAssigner<TAGGED_UNION_TYPENAME_LIST(triplets)>) { \
-    if (storage.type == other.storage.type) {				\
+    if constexpr (::tagged_union::detail::UseTrivialCopy<TAGGED_UNION_TYPENAME_LIST(triplets)>) { \
+      assign_storage_from(other.storage);				\
+    } else if (storage.type == other.storage.type) {			\
       /* In-place move assignment*/					\
       switch(storage.type) {						\
 	TAGGED_UNION_VARIADIC_FOREACH(TAGGED_UNION_MOVE_ASSGN_CASE_FROM_TRIPLET, _, triplets); \
@@ -513,7 +691,7 @@ namespace tagged_union::detail {
   }									\
   template<Type T, typename DataType>					\
   constexpr static ThisType create(DataType && data) BOOST_NOEXCEPT {	\
-    return ThisType(data, OfType<T>());					\
+    return ThisType(std::forward<DataType>(data), OfType<T>());		\
   }									\
   template<Type T> /* For void types */					\
   constexpr static ThisType create() BOOST_NOEXCEPT {			\
@@ -526,7 +704,7 @@ namespace tagged_union::detail {
   }									\
   template<Type T, typename DataType>					\
   constexpr void set_type_and_data(DataType && data) BOOST_NOEXCEPT {	\
-    return set_type_and_data_impl(std::move(data), OfType<T>());	\
+    return set_type_and_data_impl(std::forward<DataType>(data), OfType<T>()); \
   }									\
   template<Type T> /* For void types */					\
   constexpr void set_type_and_data() BOOST_NOEXCEPT {			\
@@ -0,0 +1,154 @@
+#ifndef TAGGED_UNION_ARENA_H
+#define TAGGED_UNION_ARENA_H
+
+#include <tagged_union.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <new>
+
+// Arena allocation for recursive TAGGED_UNION types (ASTs, IR, ...).
+//
+// A variant may refer to the enclosing type through an arena_ptr, which is
+// a plain non-owning pointer and is therefore trivially destructible:
+//
+//   struct Expr {
+//     TAGGED_UNION(Expr,
+//                  (NUM, double, num),
+//                  (ADD, std::pair<tagged_union::arena_ptr<Expr>, tagged_union::arena_ptr<Expr>>, add))
+//   };
+//
+// If every other variant is also trivially destructible, TAGGED_UNION
+// doesn't generate a destructor at all, and the arena doesn't keep track
+// of the nodes it hands out. Dropping the whole tree is then a handful of
+// frees, one per block, no matter how many nodes were in it.
+//
+// Nodes that do need destruction are still supported: their destructors
+// are recorded when created and run (in reverse order) when the arena is
+// released.
+
+namespace tagged_union {
+  template <typename T>
+  class arena_ptr {
+  public:
+    constexpr arena_ptr() BOOST_NOEXCEPT : ptr(nullptr) {}
+    constexpr arena_ptr(std::nullptr_t) BOOST_NOEXCEPT : ptr(nullptr) {}
+    constexpr explicit arena_ptr(T* ptr) BOOST_NOEXCEPT : ptr(ptr) {}
+
+    constexpr T* get() const BOOST_NOEXCEPT { return ptr; }
+    constexpr T& operator*() const BOOST_NOEXCEPT {
+      BOOST_ASSERT(ptr);
+      return *ptr;
+    }
+    constexpr T* operator->() const BOOST_NOEXCEPT {
+      BOOST_ASSERT(ptr);
+      return ptr;
+    }
+    constexpr explicit operator bool() const BOOST_NOEXCEPT { return ptr != nullptr; }
+
+    constexpr bool operator==(arena_ptr const& other) const BOOST_NOEXCEPT { return ptr == other.ptr; }
+    constexpr bool operator!=(arena_ptr const& other) const BOOST_NOEXCEPT { return ptr != other.ptr; }
+
+  private:
+    T* ptr;
+  };
+
+  class arena {
+  public:
+    static constexpr std::size_t default_block_size = 64 * 1024;
+    static constexpr std::size_t max_block_size = 4 * 1024 * 1024;
+
+    explicit arena(std::size_t initial_block_size = default_block_size) BOOST_NOEXCEPT
+      : next_block_size(initial_block_size) {}
+    arena(arena const&) = delete;
+    arena& operator=(arena const&) = delete;
+    arena(arena&& other) BOOST_NOEXCEPT
+      : head(std::exchange(other.head, nullptr)),
+	cursor(std::exchange(other.cursor, nullptr)),
+	end(std::exchange(other.end, nullptr)),
+	destructors(std::exchange(other.destructors, nullptr)),
+	next_block_size(other.next_block_size) {}
+    arena& operator=(arena&& other) BOOST_NOEXCEPT {
+      if (this != &other) {
+	release();
+	head = std::exchange(other.head, nullptr);
+	cursor = std::exchange(other.cursor, nullptr);
+	end = std::exchange(other.end, nullptr);
+	destructors = std::exchange(other.destructors, nullptr);
+	next_block_size = other.next_block_size;
+      }
+      return *this;
+    }
+    ~arena() { release(); }
+
+    // Raw, uninitialized memory that lives until release()
+    void* allocate(std::size_t size, std::size_t align) {
+      std::uintptr_t const aligned = (reinterpret_cast<std::uintptr_t>(cursor) + (align - 1)) & ~std::uintptr_t(align - 1);
+      if (BOOST_UNLIKELY(cursor == nullptr || aligned + size > reinterpret_cast<std::uintptr_t>(end)))
+	return allocate_slow(size, align);
+      cursor = reinterpret_cast<std::byte*>(aligned + size);
+      return reinterpret_cast<void*>(aligned);
+    }
+
+    // Constructs a T in the arena, e.g.
+    //   auto node = a.make<Expr>(Expr::create<Expr::NUM>(1.0));
+    template <typename T, typename... Args>
+    arena_ptr<T> make(Args&&... args) {
+      if constexpr (std::is_trivially_destructible_v<T>) {
+	return arena_ptr<T>(new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...));
+      } else {
+	// Reserve the record first so that a throwing constructor doesn't
+	// leave us with a record pointing at garbage
+	auto* record = static_cast<destructor_record*>(allocate(sizeof(destructor_record), alignof(destructor_record)));
+	T* const object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	destructors = new (record) destructor_record{[](void* p) { static_cast<T*>(p)->~T(); }, object, destructors};
+	return arena_ptr<T>(object);
+      }
+    }
+
+    // Destroys every non-trivially destructible object and frees all
+    // memory. The arena can be reused afterwards.
+    void release() BOOST_NOEXCEPT {
+      for (destructor_record* d = destructors; d; d = d->next)
+	d->destroy(d->object);
+      destructors = nullptr;
+      while (head) {
+	block_header* const prev = head->prev;
+	::operator delete(static_cast<void*>(head));
+	head = prev;
+      }
+      cursor = end = nullptr;
+    }
+
+  private:
+    struct block_header {
+      block_header* prev;
+    };
+    struct destructor_record {
+      void (*destroy)(void*);
+      void* object;
+      destructor_record* next;
+    };
+
+    BOOST_NOINLINE void* allocate_slow(std::size_t size, std::size_t align) {
+      std::size_t const needed = sizeof(block_header) + size + align;
+      std::size_t const block_size = std::max(needed, next_block_size);
+      next_block_size = std::min(next_block_size * 2, max_block_size);
+
+      auto* const block = static_cast<block_header*>(::operator new(block_size));
+      block->prev = head;
+      head = block;
+      cursor = reinterpret_cast<std::byte*>(block + 1);
+      end = reinterpret_cast<std::byte*>(block) + block_size;
+      return allocate(size, align);
+    }
+
+    block_header* head = nullptr;
+    std::byte* cursor = nullptr;
+    std::byte* end = nullptr;
+    destructor_record* destructors = nullptr;
+    std::size_t next_block_size;
+  };
+}
+
+#endif // TAGGED_UNION_ARENA_H
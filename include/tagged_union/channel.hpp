@@ -0,0 +1,375 @@
+#ifndef TAGGED_UNION_CHANNEL_H
+#define TAGGED_UNION_CHANNEL_H
+
+#include <tagged_union.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+// A bounded, lock-free ring buffer for passing TAGGED_UNION messages between
+// threads. There is always a single consumer; producers::single gives the
+// cheaper SPSC protocol (plain head/tail counters), while producers::multi
+// publishes each record separately so that any number of threads can push.
+//
+//   tagged_union::channel<Message> ch(1024);
+//   ch.try_push(Message::create<Message::PING>());      // producer
+//   ch.drain([]() {...},                                // consumer
+//            [](std::string& text) {...});
+//
+// Messages are stored as variable-length records rather than whole unions:
+// a small header with the tag, followed by the payload of that tag only, so
+// a channel of mostly small messages with the occasional large one doesn't
+// spend the large one's size on every message. A record that doesn't fit
+// before the end of the ring is preceded by a wrap marker and starts over
+// at the front. drain() visits payloads right where they are, without
+// building a Union first.
+//
+// The batch operations (push_n/pop_n/drain) publish and retire a whole batch
+// with a single atomic store on each side, which is where most of the
+// throughput comes from under contention. A handler that throws from drain()
+// leaves the message it threw on in the channel.
+
+namespace tagged_union {
+  enum class producers { single, multi };
+
+  template <typename Union, producers Producers = producers::single>
+  class channel {
+    static_assert(std::is_nothrow_move_constructible_v<Union>,
+		  "channel<Union> requires a nothrow move constructible TAGGED_UNION");
+
+    static constexpr bool Multi = Producers == producers::multi;
+    // Keep producer and consumer state on separate cache lines
+    static constexpr std::size_t cache_line = 64;
+
+    // Every record starts with a Header. The payload follows at its own
+    // alignment, and the record is padded to whole units so that the next
+    // Header is aligned too.
+    struct Header {
+      std::uint32_t size; // Of the whole record, in bytes
+      std::uint32_t tag;  // A Type, or wrap for padding up to the end of the ring
+    };
+    static constexpr std::uint32_t wrap = Union::type_count;
+    static constexpr std::size_t unit = std::max(alignof(Union), sizeof(Header));
+    struct alignas(unit) Unit {
+      std::byte bytes[unit];
+    };
+
+    template <std::size_t I>
+    using payload_at = typename Union::template payload_t<static_cast<typename Union::Type>(I)>;
+
+    template <std::size_t I>
+    static constexpr std::size_t payload_offset() {
+      if constexpr (std::is_void_v<payload_at<I>>)
+	return sizeof(Header);
+      else
+	return (sizeof(Header) + alignof(payload_at<I>) - 1) / alignof(payload_at<I>) * alignof(payload_at<I>);
+    }
+    template <std::size_t I>
+    static constexpr std::size_t record_size() {
+      std::size_t size = payload_offset<I>();
+      if constexpr (!std::is_void_v<payload_at<I>>)
+	size += sizeof(payload_at<I>);
+      return (size + unit - 1) / unit * unit;
+    }
+    template <std::size_t... Is>
+    static constexpr std::array<std::size_t, Union::type_count> record_sizes(std::index_sequence<Is...>) {
+      return {record_size<Is>()...};
+    }
+    static constexpr std::array<std::size_t, Union::type_count> sizes =
+      record_sizes(std::make_index_sequence<Union::type_count>());
+    static constexpr std::size_t max_record = *std::max_element(sizes.begin(), sizes.end());
+
+  public:
+    // Room for at least min_capacity messages of any type. The ring itself
+    // is rounded up to a power of two bytes.
+    explicit channel(std::size_t min_capacity)
+      : mask(round_up((min_capacity + 1) * max_record) - 1),
+	ring(new Unit[(mask + 1) / unit]),
+	published(Multi ? new std::atomic<std::size_t>[(mask + 1) / unit] : nullptr) {
+      if constexpr (Multi)
+	for (std::size_t i = 0; i < (mask + 1) / unit; ++i)
+	  published[i].store(0, std::memory_order_relaxed);
+    }
+    channel(channel const&) = delete;
+    channel& operator=(channel const&) = delete;
+    ~channel() {
+      std::size_t const tail = producer.tail.load(std::memory_order_relaxed);
+      for (std::size_t pos = consumer.head.load(std::memory_order_relaxed); pos != tail;) {
+	Header const header = header_at(pos);
+	if (header.tag != wrap)
+	  dispatch(header.tag, [&](auto index) { destroy<decltype(index)::value>(at(pos)); });
+	pos += header.size;
+      }
+    }
+
+    // How many messages are guaranteed to fit, whatever their types.
+    // Smaller variants take less room, so usually more fit.
+    std::size_t capacity() const BOOST_NOEXCEPT { return (mask + 1) / max_record - 1; }
+
+    // Only a snapshot, other threads may be pushing or popping
+    std::size_t size_approx() const BOOST_NOEXCEPT {
+      std::size_t const popped = consumer.popped.load(std::memory_order_acquire);
+      std::size_t const pushed = producer.pushed.load(std::memory_order_acquire);
+      return pushed >= popped ? pushed - popped : 0;
+    }
+
+    // == Producer side ==
+    // Returns false (leaving message untouched) if the channel is full
+    bool try_push(Union&& message) {
+      return push_n(&message, 1) == 1;
+    }
+    bool try_push(Union const& message) {
+      Union copy(message);
+      return try_push(std::move(copy));
+    }
+
+    // Moves up to n messages from first into the channel, returning how
+    // many were pushed. The pushed messages become visible all at once.
+    // The range is read twice (for sizes, then payloads), so it needs to
+    // be a forward range.
+    template <typename ForwardIt>
+    std::size_t push_n(ForwardIt first, std::size_t n) {
+      if (n == 0)
+	return 0;
+      std::size_t pos, count = 0;
+      if constexpr (Multi) {
+	pos = producer.tail.load(std::memory_order_relaxed);
+	for (;;) {
+	  std::size_t const head = consumer.head.load(std::memory_order_acquire);
+	  // Our view of tail may be older than the consumer's progress
+	  if (pos < head) {
+	    pos = producer.tail.load(std::memory_order_relaxed);
+	    continue;
+	  }
+	  std::size_t const bytes = layout(pos, capacity_bytes() - (pos - head), first, n, count);
+	  if (count == 0)
+	    return 0;
+	  // Every byte below head has been retired by the consumer, so the
+	  // whole range is ours once tail moves past it
+	  if (producer.tail.compare_exchange_weak(pos, pos + bytes, std::memory_order_relaxed))
+	    break;
+	}
+      } else {
+	pos = producer.tail.load(std::memory_order_relaxed);
+	layout(pos, capacity_bytes() - (pos - producer.cached_head), first, n, count);
+	if (count < n) {
+	  producer.cached_head = consumer.head.load(std::memory_order_acquire);
+	  layout(pos, capacity_bytes() - (pos - producer.cached_head), first, n, count);
+	}
+	if (count == 0)
+	  return 0;
+      }
+
+      for (std::size_t i = 0; i < count; ++i, ++first) {
+	Union& message = *first;
+	std::size_t const need = sizes[std::size_t(message.get_type())];
+	std::size_t const room = capacity_bytes() - (pos & mask);
+	if (room < need) {
+	  new (at(pos)) Header{std::uint32_t(room), wrap};
+	  publish_record(pos);
+	  pos += room;
+	}
+	std::byte* const record = at(pos);
+	new (record) Header{std::uint32_t(need), std::uint32_t(message.get_type())};
+	message.visit(::tagged_union::overloaded{
+	    [&](auto tag, auto& payload) {
+	      using Payload = std::decay_t<decltype(payload)>;
+	      new (record + payload_offset<std::size_t(decltype(tag)::type)>()) Payload(std::move(payload));
+	    },
+	    []() {}});
+	publish_record(pos);
+	pos += need;
+      }
+
+      if constexpr (Multi) {
+	producer.pushed.fetch_add(count, std::memory_order_release);
+      } else {
+	producer.pushed.store(producer.pushed.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+	producer.tail.store(pos, std::memory_order_release);
+      }
+      return count;
+    }
+
+    // == Consumer side (one thread only) ==
+    std::optional<Union> try_pop() {
+      std::optional<Union> out;
+      pop_n_impl(1, [&](auto index, std::byte* record) { out.emplace(take<decltype(index)::value>(record)); });
+      return out;
+    }
+
+    // Moves up to max_count messages into out, returning how many
+    template <typename OutputIt>
+    std::size_t pop_n(OutputIt out, std::size_t max_count) {
+      return pop_n_impl(max_count, [&](auto index, std::byte* record) {
+	*out++ = take<decltype(index)::value>(record);
+      });
+    }
+
+    // Visits (and then destroys) every message currently available, with
+    // the same overload conventions as visit(). Returns how many were handled.
+    template <typename... Fs>
+    std::size_t drain(Fs&&... fs) {
+      auto const visitor = ::tagged_union::overloaded{std::forward<Fs>(fs)...};
+      return pop_n_impl(std::size_t(-1), [&](auto index, std::byte* record) {
+	constexpr std::size_t I = decltype(index)::value;
+	using Tag = typename Union::template OfType<static_cast<typename Union::Type>(I)>;
+	if constexpr (std::is_void_v<payload_at<I>>)
+	  ::tagged_union::detail::invoke_void_variant(visitor, Tag());
+	else
+	  ::tagged_union::detail::invoke_variant(visitor, Tag(), *payload<I>(record));
+      });
+    }
+
+  private:
+    static std::size_t round_up(std::size_t n) {
+      std::size_t p = 2;
+      while (p < n)
+	p *= 2;
+      return p;
+    }
+
+    std::size_t capacity_bytes() const BOOST_NOEXCEPT { return mask + 1; }
+
+    std::byte* at(std::size_t pos) BOOST_NOEXCEPT {
+      return reinterpret_cast<std::byte*>(ring.get()) + (pos & mask);
+    }
+    Header header_at(std::size_t pos) BOOST_NOEXCEPT {
+      return *std::launder(reinterpret_cast<Header*>(at(pos)));
+    }
+    template <std::size_t I>
+    static payload_at<I>* payload(std::byte* record) BOOST_NOEXCEPT {
+      return std::launder(reinterpret_cast<payload_at<I>*>(record + payload_offset<I>()));
+    }
+    template <std::size_t I>
+    static void destroy(std::byte* record) BOOST_NOEXCEPT {
+      if constexpr (!std::is_void_v<payload_at<I>>)
+	payload<I>(record)->~payload_at<I>();
+    }
+    // Moves the payload out into a whole Union again
+    template <std::size_t I>
+    static Union take(std::byte* record) BOOST_NOEXCEPT {
+      constexpr auto tag = static_cast<typename Union::Type>(I);
+      if constexpr (std::is_void_v<payload_at<I>>)
+	return Union::template create<tag>();
+      else
+	return Union::template create<tag>(std::move(*payload<I>(record)));
+    }
+
+    // Calls fn(std::integral_constant<std::size_t, tag>) for a runtime tag
+    template <typename Fn, std::size_t... Is>
+    static void dispatch(std::uint32_t tag, Fn&& fn, std::index_sequence<Is...>) {
+      (void)((tag == Is && (fn(std::integral_constant<std::size_t, Is>()), true)) || ...);
+    }
+    template <typename Fn>
+    static void dispatch(std::uint32_t tag, Fn&& fn) {
+      dispatch(tag, std::forward<Fn>(fn), std::make_index_sequence<Union::type_count>());
+    }
+
+    // Bytes taken by the first count of n messages that fit in room when
+    // written at pos, wrap markers included
+    template <typename ForwardIt>
+    std::size_t layout(std::size_t pos, std::size_t room, ForwardIt first, std::size_t n,
+		       std::size_t& count) const BOOST_NOEXCEPT {
+      std::size_t bytes = 0;
+      for (count = 0; count < n; ++count, ++first) {
+	std::size_t const need = sizes[std::size_t((*first).get_type())];
+	std::size_t const left = capacity_bytes() - ((pos + bytes) & mask);
+	std::size_t const padding = left < need ? left : 0;
+	if (bytes + padding + need > room)
+	  break;
+	bytes += padding + need;
+      }
+      return bytes;
+    }
+
+    // With several producers, records may be finished out of order, so
+    // each is published by storing its (absolute) position in the index
+    // slot of its first unit. Positions never repeat, so a slot left over
+    // from an earlier lap can't be mistaken for a new record.
+    void publish_record(std::size_t pos) BOOST_NOEXCEPT {
+      if constexpr (Multi)
+	published[(pos & mask) / unit].store(pos + 1, std::memory_order_release);
+    }
+
+    // Calls fn on up to max_count available messages, destroying each one
+    // right after. If fn throws, the messages before it stay consumed and
+    // the one it threw on stays in the channel, to be popped again.
+    template <typename Fn>
+    std::size_t pop_n_impl(std::size_t max_count, Fn&& fn) {
+      std::size_t const head = consumer.head.load(std::memory_order_relaxed);
+
+      // Publishes head past everything retired so far, however we leave
+      struct Retire {
+	channel& self;
+	std::size_t const head;
+	std::size_t bytes = 0;
+	std::size_t messages = 0;
+	~Retire() {
+	  if (bytes) {
+	    self.consumer.popped.store(self.consumer.popped.load(std::memory_order_relaxed) + messages,
+				       std::memory_order_release);
+	    self.consumer.head.store(head + bytes, std::memory_order_release);
+	  }
+	}
+      } retire{*this, head};
+
+      bool refreshed = false;
+      auto const ready = [&](std::size_t pos) {
+	if constexpr (Multi) {
+	  // Producers may finish out of order, so stop at the first record
+	  // that hasn't been published yet
+	  return published[(pos & mask) / unit].load(std::memory_order_acquire) == pos + 1;
+	} else {
+	  if (pos != consumer.cached_tail)
+	    return true;
+	  if (refreshed)
+	    return false;
+	  refreshed = true;
+	  consumer.cached_tail = producer.tail.load(std::memory_order_acquire);
+	  return pos != consumer.cached_tail;
+	}
+      };
+
+      // At most one lap, so that a producer keeping up can't keep us here
+      while (retire.messages < max_count && retire.bytes < capacity_bytes()) {
+	std::size_t const pos = head + retire.bytes;
+	if (!ready(pos))
+	  break;
+	std::byte* const record = at(pos);
+	Header const header = header_at(pos);
+	if (header.tag != wrap) {
+	  dispatch(header.tag, [&](auto index) {
+	    fn(index, record);
+	    destroy<decltype(index)::value>(record);
+	  });
+	  ++retire.messages;
+	}
+	retire.bytes += header.size;
+      }
+      return retire.messages;
+    }
+
+    std::size_t const mask;
+    std::unique_ptr<Unit[]> const ring;
+    std::unique_ptr<std::atomic<std::size_t>[]> const published; // MPSC only
+
+    struct alignas(cache_line) {
+      std::atomic<std::size_t> tail{0};
+      std::atomic<std::size_t> pushed{0};
+      std::size_t cached_head = 0; // SPSC only
+    } producer;
+    struct alignas(cache_line) {
+      std::atomic<std::size_t> head{0};
+      std::atomic<std::size_t> popped{0};
+      std::size_t cached_tail = 0; // SPSC only
+    } consumer;
+  };
+}
+
+#endif // TAGGED_UNION_CHANNEL_H
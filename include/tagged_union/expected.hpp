@@ -0,0 +1,126 @@
+#ifndef TAGGED_UNION_EXPECTED_H
+#define TAGGED_UNION_EXPECTED_H
+
+#include <tagged_union.hpp>
+
+#include <functional>
+
+// A ready-made result type built on TAGGED_UNION, in the spirit of C++23's
+// std::expected but available from C++17:
+//
+//   tagged_union::expected<size_t, std::string> parse(std::string_view s) {
+//     if (s.empty())
+//       return tagged_union::unexpected<std::string>{"empty input"};
+//     return size_t(s.size());
+//   }
+//
+// The monadic operations (and_then/transform/or_else) are only available
+// on rvalues, and move the payload along rather than copying it:
+//
+//   auto doubled = parse(s).transform([](size_t n) { return n * 2; });
+//
+// Inside a function returning an expected with the same error type,
+// TAGGED_UNION_TRY unwraps a value or returns the error early:
+//
+//   TAGGED_UNION_TRY(size_t n, parse(s));
+//
+// Note that neither the value nor the error type may be void, since
+// TAGGED_UNION can only detect a literal void variant type.
+
+namespace tagged_union {
+  template <typename E>
+  struct unexpected {
+    E error;
+  };
+  template <typename E>
+  unexpected(E) -> unexpected<E>;
+
+  template <typename Value, typename Error>
+  struct expected {
+    // Two states fit in a byte, which lets the tag share a word with
+    // small payloads (expected<char, bool> is 2 bytes rather than 8).
+    // The HAS_ prefix keeps clear of macros like ERROR from <windows.h>.
+    TAGGED_UNION_WITH_TAG_TYPE(expected, unsigned char,
+			       (HAS_VALUE, Value, value),
+			       (HAS_ERROR, Error, error))
+
+    using value_type = Value;
+    using error_type = Error;
+
+    // Implicit construction from either side, for easy returns
+    constexpr expected(Value const& value)
+      noexcept(std::is_nothrow_copy_constructible_v<Value>)
+      : expected(value, OfType<HAS_VALUE>()) {}
+    constexpr expected(Value&& value)
+      noexcept(std::is_nothrow_move_constructible_v<Value>)
+      : expected(std::move(value), OfType<HAS_VALUE>()) {}
+    constexpr expected(unexpected<Error> const& unexp)
+      noexcept(std::is_nothrow_copy_constructible_v<Error>)
+      : expected(unexp.error, OfType<HAS_ERROR>()) {}
+    constexpr expected(unexpected<Error>&& unexp)
+      noexcept(std::is_nothrow_move_constructible_v<Error>)
+      : expected(std::move(unexp.error), OfType<HAS_ERROR>()) {}
+
+    constexpr bool has_value() const BOOST_NOEXCEPT {
+      return BOOST_LIKELY(get_type() == HAS_VALUE);
+    }
+    constexpr explicit operator bool() const BOOST_NOEXCEPT {
+      return has_value();
+    }
+
+    // Moves the error out, for returning from a function with a
+    // different value type
+    constexpr unexpected<Error> propagate() && {
+      return unexpected<Error>{std::move(error())};
+    }
+
+    // f(Value&&) -> expected<U, Error>
+    template <typename Fn>
+    constexpr auto and_then(Fn&& f) && {
+      using Result = std::decay_t<std::invoke_result_t<Fn, Value&&>>;
+      static_assert(std::is_same_v<typename Result::error_type, Error>,
+		    "and_then() needs to return an expected with the same error type");
+      if (has_value())
+	return std::invoke(std::forward<Fn>(f), std::move(value()));
+      return Result(std::move(*this).propagate());
+    }
+
+    // f(Value&&) -> U, giving expected<U, Error>
+    template <typename Fn>
+    constexpr auto transform(Fn&& f) && {
+      using Result = expected<std::decay_t<std::invoke_result_t<Fn, Value&&>>, Error>;
+      if (has_value())
+	return Result(std::invoke(std::forward<Fn>(f), std::move(value())));
+      return Result(std::move(*this).propagate());
+    }
+
+    // f(Error&&) -> expected<Value, G>
+    template <typename Fn>
+    constexpr auto or_else(Fn&& f) && {
+      using Result = std::decay_t<std::invoke_result_t<Fn, Error&&>>;
+      static_assert(std::is_same_v<typename Result::value_type, Value>,
+		    "or_else() needs to return an expected with the same value type");
+      if (has_value())
+	return Result(std::move(value()));
+      return std::invoke(std::forward<Fn>(f), std::move(error()));
+    }
+
+    template <typename U>
+    constexpr Value value_or(U&& fallback) && {
+      if (has_value())
+	return std::move(value());
+      return static_cast<Value>(std::forward<U>(fallback));
+    }
+  };
+}
+
+// TAGGED_UNION_TRY(<declaration>, <expression>)
+// Evaluates an expected-valued expression. On error, returns the error from
+// the enclosing function; otherwise moves the value into the declaration.
+#define TAGGED_UNION_TRY(decl, ...)					\
+  auto&& BOOST_PP_CAT(__tagged_union_try_, __LINE__) = (__VA_ARGS__);	\
+  if (BOOST_UNLIKELY(!BOOST_PP_CAT(__tagged_union_try_, __LINE__).has_value())) \
+    return std::move(BOOST_PP_CAT(__tagged_union_try_, __LINE__)).propagate(); \
+  decl = std::move(BOOST_PP_CAT(__tagged_union_try_, __LINE__).value())
+
+#endif // TAGGED_UNION_EXPECTED_H
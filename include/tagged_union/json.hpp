@@ -0,0 +1,508 @@
+#ifndef TAGGED_UNION_JSON_H
+#define TAGGED_UNION_JSON_H
+
+#include <tagged_union.hpp>
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <system_error>
+
+// JSON text for TAGGED_UNION types, written into and read from caller
+// provided buffers with no intermediate DOM or per-element allocation.
+//
+// A union is written as a single-key object, keyed by its tag:
+//   {"DENSITY":1.5}
+// and void variants as
+//   {"NONE":null}
+//
+// Payloads are handled by tagged_union::json::traits<T>, which is provided
+// for bool, arithmetic types, strings (std::string can be read, while
+// std::string_view and const char* are write-only) and nested TAGGED_UNIONs.
+// Specialize it for anything else:
+//   template <> struct tagged_union::json::traits<MyType> {
+//     static std::to_chars_result write(char* first, char* last, MyType const&);
+//     static std::from_chars_result read(char const* first, char const* last, std::optional<MyType>& out);
+//   };
+//
+// As with <charconv>, failures are reported through the ec member of the
+// result: std::errc::value_too_large when the output buffer is too small
+// (or a value has no JSON representation), and std::errc::invalid_argument
+// for malformed input.
+
+namespace tagged_union::json {
+  template <typename T, typename = void>
+  struct traits;
+
+  namespace detail {
+    template <typename T, typename = void>
+    struct IsTaggedUnion : std::false_type {};
+    template <typename T>
+    struct IsTaggedUnion<T, std::void_t<decltype(T::type_count), decltype(T::type_names)>>
+      : std::true_type {};
+
+    inline std::to_chars_result overflow(char* last) {
+      return {last, std::errc::value_too_large};
+    }
+    inline std::from_chars_result malformed(char const* where) {
+      return {where, std::errc::invalid_argument};
+    }
+
+    inline std::to_chars_result put(char* first, char* last, std::string_view text) {
+      if (std::size_t(last - first) < text.size())
+	return overflow(last);
+      std::memcpy(first, text.data(), text.size());
+      return {first + text.size(), std::errc()};
+    }
+
+    inline char const* skip_whitespace(char const* first, char const* last) {
+      while (first != last && (*first == ' ' || *first == '\t' || *first == '\n' || *first == '\r'))
+	++first;
+      return first;
+    }
+
+    // Skips whitespace and then consumes text, or returns nullptr
+    inline char const* expect(char const* first, char const* last, std::string_view text) {
+      first = skip_whitespace(first, last);
+      if (std::size_t(last - first) < text.size() || std::memcmp(first, text.data(), text.size()) != 0)
+	return nullptr;
+      return first + text.size();
+    }
+
+    // Returns the end of the JSON number at first, or nullptr if there
+    // isn't one: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    // std::from_chars alone would also take nan, inf, 1., .5 and 01.
+    inline char const* scan_number(char const* first, char const* last) {
+      auto const digit = [&](char const* p) { return p != last && *p >= '0' && *p <= '9'; };
+      auto const digits = [&](char const* p) -> char const* {
+	if (!digit(p))
+	  return nullptr;
+	while (digit(p))
+	  ++p;
+	return p;
+      };
+
+      if (first != last && *first == '-')
+	++first;
+      if (first != last && *first == '0')
+	++first;
+      else if (!(first = digits(first)))
+	return nullptr;
+      if (first != last && *first == '.' && !(first = digits(first + 1)))
+	return nullptr;
+      if (first != last && (*first == 'e' || *first == 'E')) {
+	++first;
+	if (first != last && (*first == '+' || *first == '-'))
+	  ++first;
+	first = digits(first);
+      }
+      return first;
+    }
+
+    inline std::to_chars_result write_string(char* first, char* last, std::string_view text) {
+      static constexpr char hex[] = "0123456789abcdef";
+      if (first == last)
+	return overflow(last);
+      *first++ = '"';
+      for (char const c : text) {
+	char escaped = 0;
+	switch (c) {
+	case '"': escaped = '"'; break;
+	case '\\': escaped = '\\'; break;
+	case '\n': escaped = 'n'; break;
+	case '\r': escaped = 'r'; break;
+	case '\t': escaped = 't'; break;
+	case '\b': escaped = 'b'; break;
+	case '\f': escaped = 'f'; break;
+	}
+	if (escaped) {
+	  if (last - first < 2)
+	    return overflow(last);
+	  *first++ = '\\';
+	  *first++ = escaped;
+	} else if (static_cast<unsigned char>(c) < 0x20) {
+	  if (last - first < 6)
+	    return overflow(last);
+	  *first++ = '\\';
+	  *first++ = 'u';
+	  *first++ = '0';
+	  *first++ = '0';
+	  *first++ = hex[(c >> 4) & 0xf];
+	  *first++ = hex[c & 0xf];
+	} else {
+	  if (first == last)
+	    return overflow(last);
+	  *first++ = c;
+	}
+      }
+      if (first == last)
+	return overflow(last);
+      *first++ = '"';
+      return {first, std::errc()};
+    }
+
+    inline char const* read_hex4(char const* first, char const* last, std::uint32_t& out) {
+      if (last - first < 4)
+	return nullptr;
+      out = 0;
+      for (int i = 0; i < 4; ++i, ++first) {
+	char const c = *first;
+	out <<= 4;
+	if (c >= '0' && c <= '9') out |= std::uint32_t(c - '0');
+	else if (c >= 'a' && c <= 'f') out |= std::uint32_t(c - 'a' + 10);
+	else if (c >= 'A' && c <= 'F') out |= std::uint32_t(c - 'A' + 10);
+	else return nullptr;
+      }
+      return first;
+    }
+
+    inline void append_utf8(std::string& out, std::uint32_t cp) {
+      if (cp < 0x80) {
+	out += char(cp);
+      } else if (cp < 0x800) {
+	out += char(0xc0 | (cp >> 6));
+	out += char(0x80 | (cp & 0x3f));
+      } else if (cp < 0x10000) {
+	out += char(0xe0 | (cp >> 12));
+	out += char(0x80 | ((cp >> 6) & 0x3f));
+	out += char(0x80 | (cp & 0x3f));
+      } else {
+	out += char(0xf0 | (cp >> 18));
+	out += char(0x80 | ((cp >> 12) & 0x3f));
+	out += char(0x80 | ((cp >> 6) & 0x3f));
+	out += char(0x80 | (cp & 0x3f));
+      }
+    }
+
+    // Reads a quoted string (first points at the opening quote)
+    inline std::from_chars_result read_string(char const* first, char const* last, std::string& out) {
+      if (first == last || *first != '"')
+	return malformed(first);
+      ++first;
+      out.clear();
+      for (;;) {
+	// Copy unescaped runs in one go
+	char const* run = first;
+	while (first != last && *first != '"' && *first != '\\')
+	  ++first;
+	out.append(run, first);
+	if (first == last)
+	  return malformed(first);
+	if (*first++ == '"')
+	  return {first, std::errc()};
+	if (first == last)
+	  return malformed(first);
+	switch (char const c = *first++) {
+	case '"': case '\\': case '/': out += c; break;
+	case 'n': out += '\n'; break;
+	case 'r': out += '\r'; break;
+	case 't': out += '\t'; break;
+	case 'b': out += '\b'; break;
+	case 'f': out += '\f'; break;
+	case 'u': {
+	  std::uint32_t cp;
+	  if (!(first = read_hex4(first, last, cp)))
+	    return malformed(last);
+	  if (cp >= 0xd800 && cp < 0xdc00) {
+	    // Surrogate pair
+	    std::uint32_t low;
+	    if (last - first < 2 || first[0] != '\\' || first[1] != 'u'
+		|| !(first = read_hex4(first + 2, last, low)) || low < 0xdc00 || low >= 0xe000)
+	      return malformed(last);
+	    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+	  }
+	  append_utf8(out, cp);
+	  break;
+	}
+	default:
+	  return malformed(first - 1);
+	}
+      }
+    }
+
+    // == Perfect hashing of tag names ==
+    // Two-level "hash and displace": every name is first hashed into a
+    // bucket, and each bucket stores the seed of a second hash which places
+    // all of that bucket's names into distinct, otherwise-unused slots.
+    // Everything is computed at compile time from Union::type_names, so
+    // a lookup is two hashes and one string comparison.
+    BOOST_FORCEINLINE constexpr std::uint32_t hash(std::string_view text, std::uint32_t seed) {
+      std::uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+      for (char const c : text) {
+	h ^= static_cast<unsigned char>(c);
+	h *= 16777619u;
+      }
+      h ^= h >> 16;
+      h *= 0x85ebca6bu;
+      h ^= h >> 13;
+      return h;
+    }
+
+    constexpr std::size_t next_pow2(std::size_t n) {
+      std::size_t p = 1;
+      while (p < n)
+	p *= 2;
+      return p;
+    }
+
+    template <typename Union>
+    struct TagLookup {
+      static constexpr std::size_t slot_count = next_pow2(Union::type_count) * 2;
+      static constexpr std::size_t bucket_count = next_pow2(Union::type_count);
+
+      struct Table {
+	std::array<std::uint32_t, bucket_count> seeds{};
+	// Type + 1, so that 0 is empty
+	std::array<std::size_t, slot_count> slots{};
+      };
+
+      static constexpr Table build() {
+	Table table{};
+	std::array<std::size_t, bucket_count> sizes{};
+	for (std::size_t t = 0; t < Union::type_count; ++t)
+	  ++sizes[hash(Union::type_names[t], 0) % bucket_count];
+
+	// Place the most crowded buckets first, while there is the most room
+	for (std::size_t size = Union::type_count; size > 0; --size) {
+	  for (std::size_t b = 0; b < bucket_count; ++b) {
+	    if (sizes[b] != size)
+	      continue;
+	    for (std::uint32_t seed = 1;; ++seed) {
+	      if (seed == (1u << 20))
+		throw "tagged_union::json: could not build a perfect hash for these tag names";
+	      std::array<std::size_t, slot_count> trial = table.slots;
+	      bool fits = true;
+	      for (std::size_t t = 0; t < Union::type_count && fits; ++t) {
+		if (hash(Union::type_names[t], 0) % bucket_count != b)
+		  continue;
+		std::size_t const slot = hash(Union::type_names[t], seed) % slot_count;
+		fits = trial[slot] == 0;
+		trial[slot] = t + 1;
+	      }
+	      if (fits) {
+		table.slots = trial;
+		table.seeds[b] = seed;
+		break;
+	      }
+	    }
+	  }
+	}
+	return table;
+      }
+
+      static constexpr Table table = build();
+
+      // Returns the tag index, or type_count if name isn't a tag
+      static constexpr std::size_t find(std::string_view name) {
+	std::uint32_t const seed = table.seeds[hash(name, 0) % bucket_count];
+	std::size_t const entry = table.slots[hash(name, seed) % slot_count];
+	if (entry == 0 || Union::type_names[entry - 1] != name)
+	  return Union::type_count;
+	return entry - 1;
+      }
+    };
+
+    template <typename Union, std::size_t I>
+    std::from_chars_result read_variant(char const* first, char const* last, std::optional<Union>& out) {
+      constexpr auto tag = static_cast<typename Union::Type>(I);
+      using Payload = typename Union::template payload_t<tag>;
+      if constexpr (std::is_void_v<Payload>) {
+	char const* const end = expect(first, last, "null");
+	if (!end)
+	  return malformed(first);
+	out.emplace(Union::template create<tag>());
+	return {end, std::errc()};
+      } else {
+	std::optional<Payload> payload;
+	auto const result = traits<Payload>::read(skip_whitespace(first, last), last, payload);
+	if (result.ec == std::errc())
+	  out.emplace(Union::template create<tag>(std::move(*payload)));
+	return result;
+      }
+    }
+
+    template <typename Union, std::size_t... Is>
+    std::from_chars_result read_variant_by_index(std::size_t index, char const* first, char const* last,
+						 std::optional<Union>& out, std::index_sequence<Is...>) {
+      std::from_chars_result result = malformed(first);
+      (void)((index == Is && (result = read_variant<Union, Is>(first, last, out), true)) || ...);
+      return result;
+    }
+  }
+
+  template <>
+  struct traits<bool> {
+    static std::to_chars_result write(char* first, char* last, bool value) {
+      return detail::put(first, last, value ? "true" : "false");
+    }
+    static std::from_chars_result read(char const* first, char const* last, std::optional<bool>& out) {
+      if (char const* end = detail::expect(first, last, "true")) {
+	out.emplace(true);
+	return {end, std::errc()};
+      }
+      if (char const* end = detail::expect(first, last, "false")) {
+	out.emplace(false);
+	return {end, std::errc()};
+      }
+      return detail::malformed(first);
+    }
+  };
+
+  template <typename T>
+  struct traits<T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>> {
+    static std::to_chars_result write(char* first, char* last, T value) {
+      if constexpr (std::is_floating_point_v<T>) {
+	if (!std::isfinite(value))
+	  return detail::overflow(last);
+      }
+      return std::to_chars(first, last, value);
+    }
+    static std::from_chars_result read(char const* first, char const* last, std::optional<T>& out) {
+      char const* const end = detail::scan_number(first, last);
+      if (!end)
+	return detail::malformed(first);
+      // A valid JSON number can still be the wrong kind for T (1.5 or 1e3
+      // for an int), in which case from_chars stops short of end
+      T value;
+      auto const result = std::from_chars(first, end, value);
+      if (result.ec != std::errc())
+	return result;
+      if (result.ptr != end)
+	return detail::malformed(first);
+      out.emplace(value);
+      return result;
+    }
+  };
+
+  template <>
+  struct traits<std::string_view> {
+    static std::to_chars_result write(char* first, char* last, std::string_view value) {
+      return detail::write_string(first, last, value);
+    }
+  };
+
+  template <>
+  struct traits<char const*> {
+    static std::to_chars_result write(char* first, char* last, char const* value) {
+      return detail::write_string(first, last, value);
+    }
+  };
+
+  template <>
+  struct traits<std::string> {
+    static std::to_chars_result write(char* first, char* last, std::string const& value) {
+      return detail::write_string(first, last, value);
+    }
+    static std::from_chars_result read(char const* first, char const* last, std::optional<std::string>& out) {
+      std::string value;
+      auto const result = detail::read_string(first, last, value);
+      if (result.ec == std::errc())
+	out.emplace(std::move(value));
+      return result;
+    }
+  };
+
+  template <typename Union>
+  struct traits<Union, std::enable_if_t<detail::IsTaggedUnion<Union>::value>> {
+    static std::to_chars_result write(char* first, char* last, Union const& value) {
+      auto result = detail::put(first, last, "{\"");
+      if (result.ec != std::errc())
+	return result;
+      // Tag names are identifiers, so they never need escaping
+      if ((result = detail::put(result.ptr, last, value.type_name())).ec != std::errc()
+	  || (result = detail::put(result.ptr, last, "\":")).ec != std::errc())
+	return result;
+      char* const pos = result.ptr;
+      result = value.visit(::tagged_union::overloaded{
+	  [&]() { return detail::put(pos, last, "null"); },
+	  [&](auto, auto const& payload) {
+	    return traits<std::decay_t<decltype(payload)>>::write(pos, last, payload);
+	  }});
+      if (result.ec != std::errc())
+	return result;
+      return detail::put(result.ptr, last, "}");
+    }
+
+    static std::from_chars_result read(char const* first, char const* last, std::optional<Union>& out) {
+      char const* pos = detail::expect(first, last, "{");
+      if (!pos || !(pos = detail::expect(pos, last, "\"")))
+	return detail::malformed(first);
+      char const* const key = pos;
+      while (pos != last && *pos != '"' && *pos != '\\')
+	++pos;
+      if (pos == last || *pos != '"')
+	return detail::malformed(key);
+      std::size_t const index = detail::TagLookup<Union>::find(std::string_view(key, std::size_t(pos - key)));
+      if (index == Union::type_count || !(pos = detail::expect(pos + 1, last, ":")))
+	return detail::malformed(key);
+
+      // Like <charconv>, out is only touched once the whole value parsed
+      std::optional<Union> parsed;
+      auto const result = detail::read_variant_by_index(index, pos, last, parsed,
+							std::make_index_sequence<Union::type_count>());
+      if (result.ec != std::errc())
+	return result;
+      if (!(pos = detail::expect(result.ptr, last, "}")))
+	return detail::malformed(result.ptr);
+      out.emplace(std::move(*parsed));
+      return {pos, std::errc()};
+    }
+  };
+
+  // Writes value as JSON into [first, last)
+  template <typename T>
+  std::to_chars_result to_json(char* first, char* last, T const& value) {
+    return traits<T>::write(first, last, value);
+  }
+
+  // Writes [begin, end) as a JSON array into [first, last)
+  template <typename It>
+  std::to_chars_result to_json(char* first, char* last, It begin, It end) {
+    using T = typename std::iterator_traits<It>::value_type;
+    auto result = detail::put(first, last, "[");
+    for (bool leading = true; begin != end && result.ec == std::errc(); ++begin, leading = false) {
+      if (!leading && (result = detail::put(result.ptr, last, ",")).ec != std::errc())
+	return result;
+      result = traits<T>::write(result.ptr, last, *begin);
+    }
+    if (result.ec != std::errc())
+      return result;
+    return detail::put(result.ptr, last, "]");
+  }
+
+  // Parses a JSON value from [first, last) into out, skipping any leading
+  // whitespace. On success, ptr points just past the value.
+  template <typename T>
+  std::from_chars_result from_json(char const* first, char const* last, std::optional<T>& out) {
+    return traits<T>::read(detail::skip_whitespace(first, last), last, out);
+  }
+
+  // Parses a JSON array of T from [first, last), passing each element to
+  // sink as it is read. Nothing but the elements themselves is allocated.
+  template <typename T, typename Sink>
+  std::from_chars_result from_json_array(char const* first, char const* last, Sink&& sink) {
+    char const* pos = detail::expect(first, last, "[");
+    if (!pos)
+      return detail::malformed(first);
+    if (char const* end = detail::expect(pos, last, "]"))
+      return {end, std::errc()};
+    for (;;) {
+      std::optional<T> element;
+      auto const result = from_json(pos, last, element);
+      if (result.ec != std::errc())
+	return result;
+      sink(std::move(*element));
+      if ((pos = detail::expect(result.ptr, last, ",")))
+	continue;
+      if ((pos = detail::expect(result.ptr, last, "]")))
+	return {pos, std::errc()};
+      return detail::malformed(result.ptr);
+    }
+  }
+}
+
+#endif // TAGGED_UNION_JSON_H
@@ -0,0 +1,291 @@
+#ifndef TAGGED_UNION_PARALLEL_H
+#define TAGGED_UNION_PARALLEL_H
+
+#include <tagged_union.hpp>
+
+#include <array>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// Multi-threaded algorithms over random access ranges of TAGGED_UNION
+// types. Only std::thread is needed, so link against Threads::Threads
+// (or -pthread) when using this header.
+//
+// Every algorithm accepts an optional tagged_union::parallel::policy to pin
+// the thread count and chunk size (leading for the algorithms that take a
+// variadic overload set, trailing otherwise). The defaults use every hardware
+// thread and a chunk size that gives each thread several chunks to balance.
+
+namespace tagged_union::parallel {
+  struct policy {
+    // 0 means std::thread::hardware_concurrency()
+    unsigned threads = 0;
+    // 0 means pick something reasonable for the range size
+    std::size_t chunk_size = 0;
+  };
+
+  namespace detail {
+    template <typename Range>
+    using iterator_t = decltype(std::begin(std::declval<Range&>()));
+
+    template <typename Range>
+    using union_t = typename std::iterator_traits<iterator_t<Range>>::value_type;
+
+    template <typename T>
+    static constexpr bool IsPolicy = std::is_same_v<std::decay_t<T>, policy>;
+
+    inline unsigned thread_count(policy const& p) {
+      if (p.threads)
+	return p.threads;
+      unsigned const hw = std::thread::hardware_concurrency();
+      return hw ? hw : 1;
+    }
+
+    inline std::size_t chunk_size(policy const& p, std::size_t n, unsigned threads) {
+      if (p.chunk_size)
+	return p.chunk_size;
+      // Aim for ~8 chunks per thread so that stragglers get picked up
+      // by whoever finishes first, but don't bother splitting up tiny
+      // amounts of work.
+      std::size_t constexpr min_chunk = 1024;
+      return std::max(min_chunk, n / (std::size_t(threads) * 8) + 1);
+    }
+
+    // Runs fn(block) for every block in [0, blocks). Workers claim blocks
+    // off of a shared atomic cursor, so idle threads automatically take
+    // over work that would otherwise wait on a slow thread. The calling
+    // thread participates as a worker. The first exception thrown by fn
+    // is re-thrown on the calling thread once everyone has stopped. If the
+    // system refuses to start more threads, the ones we have (at least the
+    // calling thread) finish the work instead.
+    template <typename Fn>
+    void for_each_block(std::size_t blocks, unsigned threads, Fn const& fn) {
+      if (blocks == 0)
+	return;
+      threads = unsigned(std::min<std::size_t>(threads, blocks));
+      if (threads <= 1) {
+	for (std::size_t b = 0; b < blocks; ++b)
+	  fn(b);
+	return;
+      }
+
+      std::atomic<std::size_t> cursor{0};
+      std::atomic<bool> failed{false};
+      std::exception_ptr error;
+      std::mutex error_mutex;
+
+      auto worker = [&]() noexcept {
+	for (;;) {
+	  std::size_t const b = cursor.fetch_add(1, std::memory_order_relaxed);
+	  if (b >= blocks || failed.load(std::memory_order_relaxed))
+	    return;
+	  try {
+	    fn(b);
+	  } catch (...) {
+	    std::lock_guard<std::mutex> lock(error_mutex);
+	    if (!error)
+	      error = std::current_exception();
+	    failed.store(true, std::memory_order_relaxed);
+	  }
+	}
+      };
+
+      std::vector<std::thread> pool;
+      try {
+	pool.reserve(threads - 1);
+	for (unsigned t = 1; t < threads; ++t)
+	  pool.emplace_back(worker);
+      } catch (std::system_error const&) {
+      } catch (std::bad_alloc const&) {
+      }
+      worker();
+      for (auto& thread : pool)
+	thread.join();
+
+      if (error)
+	std::rethrow_exception(error);
+    }
+
+    template <typename Range, typename... Fs>
+    void for_each_variant(policy const& p, Range&& range, Fs&&... fs) {
+      auto const first = std::begin(range);
+      std::size_t const n = std::size_t(std::distance(first, std::end(range)));
+      unsigned const threads = thread_count(p);
+      std::size_t const chunk = chunk_size(p, n, threads);
+      auto const visitor = ::tagged_union::overloaded{fs...};
+
+      for_each_block((n + chunk - 1) / chunk, threads, [&](std::size_t b) {
+	auto it = first + b * chunk;
+	auto const last = first + std::min(n, (b + 1) * chunk);
+	for (; it != last; ++it)
+	  (*it).visit(visitor);
+      });
+    }
+
+    template <typename Range, typename T, typename Combine, typename... Fs>
+    auto reduce_by_type(policy const& p, Range&& range, T const& init,
+			Combine const& combine, Fs&&... fs) {
+      using Union = union_t<Range>;
+      using Totals = std::array<T, Union::type_count>;
+
+      auto const first = std::begin(range);
+      std::size_t const n = std::size_t(std::distance(first, std::end(range)));
+      unsigned const threads = thread_count(p);
+      std::size_t const chunk = chunk_size(p, n, threads);
+      std::size_t const blocks = (n + chunk - 1) / chunk;
+      auto const visitor = ::tagged_union::overloaded{fs...};
+
+      Totals filled;
+      filled.fill(init);
+      // One partial result per block rather than per thread keeps the
+      // final combine order (and thus floating point results) independent
+      // of scheduling.
+      std::vector<Totals> partials(blocks, filled);
+
+      for_each_block(blocks, threads, [&](std::size_t b) {
+	Totals& local = partials[b];
+	auto it = first + b * chunk;
+	auto const last = first + std::min(n, (b + 1) * chunk);
+	for (; it != last; ++it) {
+	  T& slot = local[std::size_t((*it).get_type())];
+	  slot = combine(std::move(slot), (*it).visit(visitor));
+	}
+      });
+
+      for (Totals const& partial : partials)
+	for (std::size_t t = 0; t < Union::type_count; ++t)
+	  filled[t] = combine(std::move(filled[t]), partial[t]);
+      return filled;
+    }
+
+    // Uninitialized storage for n Unions, freed (but not destroyed) on
+    // every way out of partition_by_type()
+    template <typename Union>
+    struct ScratchBuffer {
+      explicit ScratchBuffer(std::size_t n) : data(std::allocator<Union>().allocate(n)), size(n) {}
+      ScratchBuffer(ScratchBuffer const&) = delete;
+      ScratchBuffer& operator=(ScratchBuffer const&) = delete;
+      ~ScratchBuffer() { std::allocator<Union>().deallocate(data, size); }
+
+      Union* const data;
+      std::size_t const size;
+    };
+
+    template <typename Range, typename Tag>
+    auto partition_by_type(policy const& p, Range&& range, Tag type) {
+      using Union = union_t<Range>;
+      // Once elements start moving into scratch space there's no way to
+      // put a half-moved range back together, so moves must not throw.
+      // Every TAGGED_UNION of nothrow movable types qualifies.
+      static_assert(std::is_nothrow_move_constructible_v<Union>
+		    && std::is_nothrow_move_assignable_v<Union>,
+		    "partition_by_type() requires a nothrow movable TAGGED_UNION");
+
+      auto const first = std::begin(range);
+      std::size_t const n = std::size_t(std::distance(first, std::end(range)));
+      unsigned const threads = thread_count(p);
+      std::size_t const chunk = chunk_size(p, n, threads);
+      std::size_t const blocks = (n + chunk - 1) / chunk;
+      if (n == 0)
+	return first;
+
+      // Pass 1: count matches per block
+      std::vector<std::size_t> matches(blocks);
+      for_each_block(blocks, threads, [&](std::size_t b) {
+	std::size_t count = 0;
+	auto it = first + b * chunk;
+	auto const last = first + std::min(n, (b + 1) * chunk);
+	for (; it != last; ++it)
+	  count += (*it).get_type() == type;
+	matches[b] = count;
+      });
+
+      // Exclusive scan into output offsets. Block order is preserved on
+      // both sides of the partition point, which is what makes this stable.
+      std::size_t total_matches = 0;
+      for (std::size_t& m : matches) {
+	std::size_t const count = m;
+	m = total_matches;
+	total_matches += count;
+      }
+
+      // Pass 2: scatter into uninitialized scratch space
+      ScratchBuffer<Union> buffer(n);
+      Union* const scratch = buffer.data;
+      for_each_block(blocks, threads, [&](std::size_t b) {
+	std::size_t const begin = b * chunk;
+	std::size_t hit = matches[b];
+	std::size_t miss = total_matches + (begin - matches[b]);
+	auto it = first + begin;
+	auto const last = first + std::min(n, begin + chunk);
+	for (; it != last; ++it)
+	  new (scratch + ((*it).get_type() == type ? hit++ : miss++)) Union(std::move(*it));
+      });
+
+      // Pass 3: move everything back
+      for_each_block(blocks, threads, [&](std::size_t b) {
+	std::size_t const begin = b * chunk;
+	std::size_t const end = std::min(n, begin + chunk);
+	for (std::size_t i = begin; i < end; ++i) {
+	  first[i] = std::move(scratch[i]);
+	  scratch[i].~Union();
+	}
+      });
+
+      return first + total_matches;
+    }
+  }
+
+  // Calls the matching overload for every element of range. Overloads take
+  // either (OfType<tag>, payload&) or just (payload&), like visit(), and
+  // void variants call their (OfType<tag>) overload or the nullary one.
+  template <typename Range, typename... Fs,
+	    typename = std::enable_if_t<!detail::IsPolicy<Range>>>
+  void for_each_variant(Range&& range, Fs&&... fs) {
+    detail::for_each_variant(policy{}, std::forward<Range>(range), std::forward<Fs>(fs)...);
+  }
+  template <typename Range, typename... Fs>
+  void for_each_variant(policy const& p, Range&& range, Fs&&... fs) {
+    detail::for_each_variant(p, std::forward<Range>(range), std::forward<Fs>(fs)...);
+  }
+
+  // Maps every element through the overloads and folds the results with
+  // combine, separately for each tag. Returns an std::array indexed by Type.
+  //   auto totals = reduce_by_type(v, 0.0, std::plus<>(), [](auto const& x) { return double(x); },
+  //                                [] { return 0.0; });
+  //   totals[Property::DENSITY];
+  template <typename Range, typename T, typename Combine, typename... Fs,
+	    typename = std::enable_if_t<!detail::IsPolicy<Range>>>
+  auto reduce_by_type(Range&& range, T const& init, Combine const& combine, Fs&&... fs) {
+    return detail::reduce_by_type(policy{}, std::forward<Range>(range), init, combine, std::forward<Fs>(fs)...);
+  }
+  template <typename Range, typename T, typename Combine, typename... Fs>
+  auto reduce_by_type(policy const& p, Range&& range, T const& init, Combine const& combine, Fs&&... fs) {
+    return detail::reduce_by_type(p, std::forward<Range>(range), init, combine, std::forward<Fs>(fs)...);
+  }
+
+  // Number of elements of each tag, indexed by Type.
+  template <typename Range>
+  auto count_by_type(Range&& range, policy const& p = {}) {
+    return detail::reduce_by_type(p, std::forward<Range>(range), std::size_t(0), std::plus<>(),
+				  [](auto&&...) { return std::size_t(1); });
+  }
+
+  // Stable partition: every element of the given tag is moved to the front,
+  // with the relative order on both sides unchanged. Returns an iterator to
+  // the first element that is not of the given tag.
+  template <typename Range, typename Tag>
+  auto partition_by_type(Range&& range, Tag type, policy const& p = {}) {
+    return detail::partition_by_type(p, std::forward<Range>(range), type);
+  }
+}
+
+#endif // TAGGED_UNION_PARALLEL_H
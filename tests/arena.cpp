@@ -0,0 +1,84 @@
+#include <tagged_union/arena.hpp>
+#include <iostream>
+#include <string>
+#include <utility>
+
+// A recursive expression tree. Children are arena_ptrs, so every variant
+// is trivially destructible and neither the nodes nor the arena run any
+// per-node teardown.
+struct Expr {
+  TAGGED_UNION(Expr,
+	       (NUM, double, num),
+	       (NEG, tagged_union::arena_ptr<Expr>, neg),
+	       (ADD, std::pair<tagged_union::arena_ptr<Expr>, tagged_union::arena_ptr<Expr>>, add),
+	       (MUL, std::pair<tagged_union::arena_ptr<Expr>, tagged_union::arena_ptr<Expr>>, mul))
+
+  double eval() const {
+    switch (get_type()) {
+    case NUM: return num();
+    case NEG: return -neg()->eval();
+    case ADD: return add().first->eval() + add().second->eval();
+    case MUL: return mul().first->eval() * mul().second->eval();
+    }
+    return 0;
+  }
+};
+static_assert(std::is_trivially_destructible_v<Expr>,
+	      "arena_ptr children should not require a destructor");
+
+// Sum of 1..n as a balanced tree of ADDs
+tagged_union::arena_ptr<Expr> build(tagged_union::arena& a, size_t lo, size_t hi) {
+  if (lo == hi)
+    return a.make<Expr>(Expr::create<Expr::NUM>(double(lo)));
+  size_t const mid = lo + (hi - lo) / 2;
+  auto const left = build(a, lo, mid);
+  auto const right = build(a, mid + 1, hi);
+  return a.make<Expr>(Expr::create<Expr::ADD>(std::make_pair(left, right)));
+}
+
+// Nodes with non-trivial payloads still get destroyed by the arena
+static size_t destroyed = 0;
+struct Counted {
+  std::string name;
+  ~Counted() { ++destroyed; }
+  bool operator==(Counted const& other) const { return name == other.name; }
+};
+struct Named {
+  TAGGED_UNION(Named,
+	       (LEAF, Counted, leaf),
+	       (WRAP, tagged_union::arena_ptr<Named>, wrap))
+};
+
+int main() {
+  size_t const n = 100000;
+  {
+    tagged_union::arena a;
+    auto const root = build(a, 1, n);
+    double const sum = root->eval();
+    std::cout << "sum(1.." << n << ") = " << sum << std::endl;
+    if (sum != double(n) * (n + 1) / 2)
+      return 1;
+
+    auto const negated = a.make<Expr>(Expr::create<Expr::NEG>(
+      a.make<Expr>(Expr::create<Expr::MUL>(std::make_pair(root, root)))));
+    if (negated->eval() != -sum * sum)
+      return 1;
+
+    // Reusable after release
+    a.release();
+    if (build(a, 1, 10)->eval() != 55)
+      return 1;
+  }
+
+  {
+    tagged_union::arena a(64); // Tiny blocks to exercise growth
+    auto node = a.make<Named>(Named::create<Named::LEAF>(Counted{"leaf"}));
+    for (int i = 0; i < 100; ++i)
+      node = a.make<Named>(Named::create<Named::WRAP>(node));
+    destroyed = 0;
+    a.release();
+    std::cout << "destroyed " << destroyed << " payloads" << std::endl;
+    if (destroyed != 1)
+      return 1;
+  }
+}
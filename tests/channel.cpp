@@ -0,0 +1,234 @@
+#include <tagged_union/channel.hpp>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Message {
+  TAGGED_UNION(Message,
+	       (VALUE, size_t, value),
+	       (TEXT, std::string, text),
+	       (STOP, void, void))
+};
+
+Message make_message(size_t i) {
+  if (i % 3 == 0)
+    return Message::create<Message::TEXT>(std::to_string(i));
+  return Message::create<Message::VALUE>(i);
+}
+
+size_t message_number(Message const& m) {
+  return m.get_type() == Message::TEXT ? std::stoul(m.text()) : m.value();
+}
+
+int check_spsc() {
+  size_t const count = 20000;
+  tagged_union::channel<Message> ch(100);
+  if (ch.capacity() < 100)
+    return 1;
+
+  std::thread producer([&] {
+    std::vector<Message> batch;
+    for (size_t i = 0; i < count;) {
+      // Alternate between single pushes and batches
+      if (i % 2) {
+	while (!ch.try_push(make_message(i)))
+	  std::this_thread::yield();
+	++i;
+      } else {
+	batch.clear();
+	for (size_t j = i; j < std::min(count, i + 37); ++j)
+	  batch.push_back(make_message(j));
+	size_t pushed = 0;
+	while (pushed < batch.size()) {
+	  pushed += ch.push_n(batch.begin() + pushed, batch.size() - pushed);
+	  std::this_thread::yield();
+	}
+	i += batch.size();
+      }
+    }
+    while (!ch.try_push(Message::create<Message::STOP>()))
+      std::this_thread::yield();
+  });
+
+  size_t expected = 0;
+  bool stopped = false, in_order = true;
+  std::vector<Message> popped;
+  while (!stopped) {
+    // Mix up the consumer side too
+    if (expected % 5 == 0) {
+      popped.clear();
+      ch.pop_n(std::back_inserter(popped), 16);
+      for (auto const& m : popped) {
+	if (m.get_type() == Message::STOP)
+	  stopped = true;
+	else
+	  in_order &= message_number(m) == expected++;
+      }
+    } else {
+      ch.drain([&]() { stopped = true; },
+	       [&](size_t v) { in_order &= v == expected++; },
+	       [&](std::string& s) { in_order &= std::stoul(s) == expected++; });
+    }
+  }
+  producer.join();
+
+  if (!in_order || expected != count || ch.try_pop()) {
+    std::cerr << "SPSC: got " << expected << " in order: " << in_order << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int check_mpsc() {
+  size_t const producers = 4;
+  size_t const per_producer = 5000;
+  tagged_union::channel<Message, tagged_union::producers::multi> ch(64);
+
+  // Each producer sends an increasing sequence tagged with its id
+  std::vector<std::thread> threads;
+  for (size_t p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] {
+      for (size_t i = 0; i < per_producer;) {
+	if (i % 4 == 0) {
+	  Message batch[] = {make_message(i * producers + p), make_message((i + 1) * producers + p)};
+	  size_t pushed = 0;
+	  while (pushed < 2) {
+	    pushed += ch.push_n(batch + pushed, 2 - pushed);
+	    std::this_thread::yield();
+	  }
+	  i += 2;
+	} else {
+	  while (!ch.try_push(make_message(i * producers + p)))
+	    std::this_thread::yield();
+	  ++i;
+	}
+      }
+    });
+  }
+
+  std::vector<size_t> next(producers, 0);
+  size_t received = 0;
+  bool in_order = true;
+  auto const check = [&](size_t n) {
+    in_order &= n / producers == next[n % producers]++;
+    ++received;
+  };
+  while (received < producers * per_producer) {
+    if (!ch.drain([&](size_t v) { check(v); },
+		  [&](std::string const& s) { check(std::stoul(s)); },
+		  [&]() { in_order = false; }))
+      std::this_thread::yield();
+  }
+  for (auto& t : threads)
+    t.join();
+
+  if (!in_order || ch.size_approx() != 0) {
+    std::cerr << "MPSC: messages out of order" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Two void variants, told apart by their tags
+struct Control {
+  TAGGED_UNION(Control,
+	       (PING, void, void),
+	       (STOP, void, void),
+	       (DELAY, size_t, delay))
+};
+
+int check_void_tags() {
+  tagged_union::channel<Control> ch(8);
+  ch.try_push(Control::create<Control::PING>());
+  ch.try_push(Control::create<Control::DELAY>(size_t(5)));
+  ch.try_push(Control::create<Control::PING>());
+  ch.try_push(Control::create<Control::STOP>());
+
+  size_t pings = 0, stops = 0, delay = 0;
+  ch.drain([&](Control::OfType<Control::PING>) { ++pings; },
+	   [&](Control::OfType<Control::STOP>) { ++stops; },
+	   [&](size_t d) { delay += d; });
+  if (pings != 2 || stops != 1 || delay != 5) {
+    std::cerr << "void tags: " << pings << " pings, " << stops << " stops" << std::endl;
+    return 1;
+  }
+
+  // A generic payload handler next to a tag overload: PING goes to its
+  // overload, STOP (with no overload of its own) to the nullary one
+  ch.try_push(Control::create<Control::PING>());
+  ch.try_push(Control::create<Control::DELAY>(size_t(7)));
+  ch.try_push(Control::create<Control::STOP>());
+  pings = stops = delay = 0;
+  ch.drain([&](auto const& d) { delay += d; },
+	   [&](Control::OfType<Control::PING> const&) { ++pings; },
+	   [&]() { ++stops; });
+  return pings == 1 && stops == 1 && delay == 7 ? 0 : 1;
+}
+
+// A throwing handler leaves its message (and everything after it) queued
+template <tagged_union::producers Producers>
+int check_throwing_handler() {
+  tagged_union::channel<Message, Producers> ch(8);
+  for (size_t i = 0; i < 4; ++i)
+    ch.try_push(make_message(i));
+
+  size_t handled = 0;
+  try {
+    ch.drain([&](size_t v) {
+	       if (v == 2)
+		 throw v;
+	       ++handled;
+	     },
+	     [&](std::string const&) { ++handled; },
+	     [&]() {});
+  } catch (size_t) {
+  }
+  auto const next = ch.try_pop();
+  if (handled != 2 || !next || message_number(*next) != 2 || ch.size_approx() != 1) {
+    std::cerr << "throwing handler: handled " << handled << std::endl;
+    return 1;
+  }
+  // The freed room is usable again
+  for (size_t i = 1; i < ch.capacity(); ++i)
+    if (!ch.try_push(make_message(i)))
+      return 1;
+  return ch.size_approx() == ch.capacity() ? 0 : 1;
+}
+
+// Records only take the room of their own variant, and wrap around the end
+int check_record_sizes() {
+  tagged_union::channel<Message> ch(4);
+  size_t stops = 0;
+  while (ch.try_push(Message::create<Message::STOP>()))
+    ++stops;
+  if (stops <= ch.capacity())
+    return 1;
+
+  // Leave a gap at the front and refill it with larger records
+  std::vector<Message> popped;
+  ch.pop_n(std::back_inserter(popped), stops / 2 + 1);
+  size_t texts = 0;
+  while (ch.try_push(Message::create<Message::TEXT>(std::to_string(texts))))
+    ++texts;
+  size_t seen_stops = 0, seen_texts = 0;
+  bool in_order = true;
+  ch.drain([&](std::string const& text) { in_order &= text == std::to_string(seen_texts++); },
+	   [&](size_t) { in_order = false; },
+	   [&]() { in_order &= seen_texts == 0; ++seen_stops; });
+  return texts > 0 && in_order && seen_texts == texts && seen_stops == stops - popped.size() ? 0 : 1;
+}
+
+int main() {
+  if (check_spsc() || check_mpsc() || check_void_tags()
+      || check_throwing_handler<tagged_union::producers::single>()
+      || check_throwing_handler<tagged_union::producers::multi>()
+      || check_record_sizes())
+    return 1;
+
+  // Leftover messages are destroyed with the channel
+  tagged_union::channel<Message> leftover(4);
+  leftover.try_push(Message::create<Message::TEXT>(std::string(100, 'x')));
+  std::cout << "ok" << std::endl;
+}
@@ -0,0 +1,185 @@
+# Compiles codegen.cpp and checks the generated x86-64 code.
+#
+# Expected -D arguments:
+#   COMPILER, COMPILER_ID, STANDARD  the C++ compiler, its CMake id and -std level
+#   COMPILER_VERSION                 the compiler's version, only the major part is used
+#   INCLUDES                         include directories, separated by |
+#   NM                               nm, for code sizes (optional)
+#   SOURCE_DIR, WORK_DIR             where codegen.cpp lives, and scratch space
+#
+# Fails if a rule from expectations.txt is broken, or if a function grew
+# past baseline-${COMPILER_ID}-<major version>.txt. Code size differs from
+# one compiler release to the next, so without a baseline for this exact
+# compiler only the rules are checked. Set UPDATE_BASELINE=ON to write the
+# baseline for the current compiler instead.
+cmake_minimum_required(VERSION 3.14)
+
+set(source "${SOURCE_DIR}/codegen.cpp")
+set(asm "${WORK_DIR}/codegen.s")
+set(obj "${WORK_DIR}/codegen.o")
+string(REGEX MATCH "^[0-9]+" compiler_major "${COMPILER_VERSION}")
+set(compiler_key "${COMPILER_ID}-${compiler_major}")
+set(baseline_file "${SOURCE_DIR}/baseline-${compiler_key}.txt")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+string(REPLACE "|" ";" include_list "${INCLUDES}")
+set(flags -std=c++${STANDARD} -O2 -DNDEBUG -fno-asynchronous-unwind-tables)
+foreach(dir IN LISTS include_list)
+  # Re-adding the default system directory with -I breaks #include_next
+  if(dir AND NOT dir MATCHES "^/usr/include/?$")
+    list(APPEND flags "-I${dir}")
+  endif()
+endforeach()
+
+# == Compile ==
+foreach(output IN ITEMS asm obj)
+  if(output STREQUAL "asm")
+    set(mode -S)
+  else()
+    set(mode -c)
+  endif()
+  execute_process(COMMAND "${COMPILER}" ${flags} ${mode} "${source}" -o "${${output}}"
+    RESULT_VARIABLE rc ERROR_VARIABLE err)
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "Failed to compile ${source}:\n${err}")
+  endif()
+endforeach()
+
+# == Read expectations ==
+set(functions "")
+file(STRINGS "${SOURCE_DIR}/expectations.txt" lines)
+foreach(line IN LISTS lines)
+  if(line MATCHES "^[ \t]*(#|$)")
+    continue()
+  endif()
+  string(REGEX REPLACE "[ \t]+" ";" fields "${line}")
+  list(GET fields 0 fn)
+  list(REMOVE_AT fields 0)
+  list(APPEND functions ${fn})
+  set(rules_${fn} ${fields})
+  set(count_${fn} 0)
+  set(mnemonics_${fn} "")
+  set(violations_${fn} "")
+endforeach()
+
+# == Walk the assembly ==
+# Function labels start a body, and .cfi_endproc/.size (or the next
+# function) end it. Directives and local labels are skipped.
+set(current "")
+file(STRINGS "${asm}" asm_lines)
+foreach(line IN LISTS asm_lines)
+  if(line MATCHES "^([A-Za-z_][A-Za-z0-9_]*):")
+    set(current "")
+    if(CMAKE_MATCH_1 IN_LIST functions)
+      set(current ${CMAKE_MATCH_1})
+    endif()
+  elseif(current STREQUAL "")
+    continue()
+  elseif(line MATCHES "^[ \t]+\\.(cfi_endproc|size)")
+    set(current "")
+  elseif(line MATCHES "^[ \t]+(rep[a-z]*[ \t]+)?([a-z][a-z0-9]*)[ \t]*([^#]*)")
+    set(mnemonic ${CMAKE_MATCH_2})
+    set(operands "${CMAKE_MATCH_3}")
+    if(mnemonic MATCHES "^(endbr64|nop)")
+      continue()
+    endif()
+    math(EXPR count_${current} "${count_${current}} + 1")
+    list(APPEND mnemonics_${current} ${mnemonic})
+
+    set(is_ret FALSE)
+    set(is_memcpy FALSE)
+    if(mnemonic MATCHES "^retq?$")
+      set(is_ret TRUE)
+    endif()
+    if(mnemonic MATCHES "^(call|jmp)" AND operands MATCHES "memcpy")
+      set(is_memcpy TRUE)
+    endif()
+
+    foreach(rule IN LISTS rules_${current})
+      if(rule STREQUAL "empty" AND NOT is_ret)
+	list(APPEND violations_${current} "not empty: ${mnemonic}")
+      elseif(rule STREQUAL "no-branch" AND mnemonic MATCHES "^j" AND NOT is_memcpy)
+	list(APPEND violations_${current} "branch: ${mnemonic}")
+      elseif(rule STREQUAL "no-compare" AND mnemonic MATCHES "^(cmp|test)")
+	list(APPEND violations_${current} "compare: ${mnemonic}")
+      elseif(rule STREQUAL "mov-only" AND NOT (is_ret OR is_memcpy OR mnemonic MATCHES "^v?mov"))
+	list(APPEND violations_${current} "not a move: ${mnemonic}")
+      endif()
+    endforeach()
+  endif()
+endforeach()
+
+# == Code sizes ==
+if(NM)
+  execute_process(COMMAND "${NM}" -S --defined-only "${obj}"
+    OUTPUT_VARIABLE nm_output RESULT_VARIABLE rc)
+  if(rc EQUAL 0)
+    string(REPLACE "\n" ";" nm_lines "${nm_output}")
+    foreach(line IN LISTS nm_lines)
+      if(line MATCHES "^[0-9a-fA-F]+ ([0-9a-fA-F]+) [Tt] ([A-Za-z0-9_]+)$"
+	  AND CMAKE_MATCH_2 IN_LIST functions)
+	math(EXPR bytes_${CMAKE_MATCH_2} "0x${CMAKE_MATCH_1}")
+      endif()
+    endforeach()
+  endif()
+endif()
+
+# == Baseline ==
+if(EXISTS "${baseline_file}" AND NOT UPDATE_BASELINE)
+  file(STRINGS "${baseline_file}" lines)
+  foreach(line IN LISTS lines)
+    if(line MATCHES "^([A-Za-z_][A-Za-z0-9_]*)[ \t]+([0-9]+)[ \t]+([0-9-]+)")
+      set(baseline_count_${CMAKE_MATCH_1} ${CMAKE_MATCH_2})
+      set(baseline_bytes_${CMAKE_MATCH_1} ${CMAKE_MATCH_3})
+    endif()
+  endforeach()
+elseif(NOT UPDATE_BASELINE)
+  message(STATUS "No baseline for ${compiler_key}, only checking rules")
+endif()
+
+# == Report ==
+set(failed FALSE)
+set(new_baseline "# function instructions bytes (-O2 -DNDEBUG, -std=c++${STANDARD})\n")
+foreach(fn IN LISTS functions)
+  if(count_${fn} EQUAL 0)
+    message(SEND_ERROR "${fn}: not found in the generated assembly")
+    set(failed TRUE)
+    continue()
+  endif()
+  if(NOT DEFINED bytes_${fn})
+    set(bytes_${fn} "-")
+  endif()
+  string(REPLACE ";" " " listing "${mnemonics_${fn}}")
+  message(STATUS "${fn}: ${count_${fn}} instructions, ${bytes_${fn}} bytes [${listing}]")
+  string(APPEND new_baseline "${fn} ${count_${fn}} ${bytes_${fn}}\n")
+
+  foreach(violation IN LISTS violations_${fn})
+    message(SEND_ERROR "${fn}: ${violation} (expected: ${rules_${fn}})")
+    set(failed TRUE)
+  endforeach()
+
+  if(DEFINED baseline_count_${fn})
+    if(count_${fn} GREATER baseline_count_${fn})
+      message(SEND_ERROR "${fn}: ${count_${fn}} instructions, baseline is ${baseline_count_${fn}}")
+      set(failed TRUE)
+    elseif(count_${fn} LESS baseline_count_${fn})
+      message(STATUS "${fn}: improved on the baseline of ${baseline_count_${fn}} instructions, consider updating it")
+    endif()
+    if(NOT bytes_${fn} STREQUAL "-" AND NOT baseline_bytes_${fn} STREQUAL "-"
+	AND bytes_${fn} GREATER baseline_bytes_${fn})
+      message(SEND_ERROR "${fn}: ${bytes_${fn}} bytes, baseline is ${baseline_bytes_${fn}}")
+      set(failed TRUE)
+    endif()
+  elseif(EXISTS "${baseline_file}")
+    message(STATUS "${fn}: not in the baseline yet")
+  endif()
+endforeach()
+
+if(UPDATE_BASELINE)
+  file(WRITE "${baseline_file}" "${new_baseline}")
+  message(STATUS "Wrote ${baseline_file}")
+endif()
+
+if(failed)
+  message(FATAL_ERROR "Codegen regressions found, see above")
+endif()
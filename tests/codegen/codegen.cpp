@@ -0,0 +1,75 @@
+// Representative TAGGED_UNION operations for the codegen regression suite.
+// This isn't a test program by itself: check_codegen.cmake compiles it at
+// -O2 -DNDEBUG and inspects the object code of each extern "C" function
+// against expectations.txt and the per-compiler baseline.
+#include <tagged_union.hpp>
+#include <new>
+#include <string>
+
+struct Inner {
+  TAGGED_UNION(Inner,
+	       (ID, unsigned long, id),
+	       (UNASSIGNED, void, void))
+};
+
+// Nested empty-destructor unions should all have zero code
+struct Outer {
+  TAGGED_UNION(Outer,
+	       (INNER, Inner, inner),
+	       (COUNT, int, count),
+	       (NONE, void, void))
+};
+
+struct Scalar {
+  TAGGED_UNION(Scalar,
+	       (LONG, long, lo),
+	       (INTEGER, int, in),
+	       (REAL, double, re),
+	       (NONE, void, void))
+};
+
+struct Mixed {
+  TAGGED_UNION(Mixed,
+	       (NAME, std::string, name),
+	       (ID, long, id))
+};
+
+// The release-mode create_empty() pattern from tests/empty.cpp
+struct Target {
+  TAGGED_UNION(Target,
+	       (ID, unsigned long, id),
+	       (EXPLICITLY_UNASSIGNED, void, void))
+
+  static Target create_empty() noexcept {
+    alignas(Target) std::byte storage[sizeof(Target)];
+    auto* ptr = reinterpret_cast<Target*>(&storage);
+    auto ret = std::move(*ptr);
+    ret.storage.attr.__empty = {};
+    return ret;
+  }
+};
+
+extern "C" {
+  void tu_destroy_nested(Outer* o) { o->~Outer(); }
+  void tu_destroy_scalar(Scalar* s) { s->~Scalar(); }
+  void tu_destroy_mixed(Mixed* m) { m->~Mixed(); }
+
+  unsigned long tu_create_empty_then_set(unsigned long value) {
+    Target t = Target::create_empty();
+    t.set_type_and_data<Target::ID>(value);
+    return t.id();
+  }
+
+  long tu_accessor(Scalar* s) { return s->lo(); }
+  double tu_accessor_const(Scalar const* s) { return s->re(); }
+  int tu_get_type(Scalar const* s) { return s->get_type(); }
+
+  void tu_copy_construct(Scalar* dst, Scalar const* src) { new (dst) Scalar(*src); }
+  void tu_move_construct(Scalar* dst, Scalar* src) { new (dst) Scalar(std::move(*src)); }
+  void tu_copy_assign(Scalar* dst, Scalar const* src) { *dst = *src; }
+  void tu_move_assign(Scalar* dst, Scalar* src) { *dst = std::move(*src); }
+  void tu_copy_nested(Outer* dst, Outer const* src) { new (dst) Outer(*src); }
+
+  void tu_set_same_type(Scalar* s, long value) { s->set_type_and_data<Scalar::LONG>(value); }
+  bool tu_equal(Scalar const* a, Scalar const* b) { return *a == *b; }
+}
@@ -0,0 +1,76 @@
+// <windows.h> (wingdi.h) defines ERROR, which must not break the header
+#define ERROR 0
+#include <tagged_union/expected.hpp>
+#include <string>
+#include <iostream>
+
+// The SimpleExpected example from string.cpp, using the ready-made type
+using Result = tagged_union::expected<size_t, std::string>;
+
+Result checked_add(size_t a, size_t b) {
+  if (a + b < a)
+    return tagged_union::unexpected<std::string>{"overflow"};
+  return a + b;
+}
+
+// The tag is a single byte
+static_assert(std::is_same_v<std::underlying_type_t<Result::Type>, unsigned char>);
+static_assert(sizeof(tagged_union::expected<char, bool>) == 2);
+
+Result fib(size_t n) {
+  if (n <= 1)
+    return n;
+  TAGGED_UNION_TRY(size_t a, fib(n - 1));
+  TAGGED_UNION_TRY(size_t b, fib(n - 2));
+  return checked_add(a, b);
+}
+
+// Propagating into a different value type
+tagged_union::expected<std::string, std::string> fib_string(size_t n) {
+  TAGGED_UNION_TRY(size_t value, fib(n));
+  return std::to_string(value);
+}
+
+int main() {
+  for (size_t i = 0; i < 10; ++i) {
+    auto result = fib_string(i);
+    std::cout << "fib(" << i << ") = " << result.value() << "\n";
+  }
+
+  // fib(94) overflows 64 bits. Use a fast version to get there.
+  auto fast_fib = [](size_t n) -> Result {
+    size_t a = 0, b = 1;
+    for (size_t i = 0; i < n; ++i) {
+      TAGGED_UNION_TRY(size_t next, checked_add(a, b));
+      a = b;
+      b = next;
+    }
+    return a;
+  };
+  auto overflowed = fast_fib(94);
+  if (overflowed || overflowed.error() != "overflow")
+    return 1;
+
+  // Monadic chains
+  auto const chained = fast_fib(10)
+    .and_then([](size_t n) { return checked_add(n, 1); })
+    .transform([](size_t n) { return std::to_string(n); })
+    .or_else([](std::string&& e) {
+      return tagged_union::expected<std::string, int>(tagged_union::unexpected<int>{int(e.size())});
+    });
+  std::cout << "fib(10) + 1 = " << chained.value() << std::endl;
+  if (chained.value() != "56")
+    return 1;
+
+  auto const recovered = fast_fib(94)
+    .transform([](size_t) { return std::string("unreachable"); })
+    .or_else([](std::string&& e) -> tagged_union::expected<std::string, std::string> {
+      return "recovered from " + e;
+    });
+  std::cout << recovered.value() << std::endl;
+  if (recovered.value() != "recovered from overflow")
+    return 1;
+
+  if (std::move(overflowed).value_or(7) != 7)
+    return 1;
+}
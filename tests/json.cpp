@@ -0,0 +1,128 @@
+#include <tagged_union/json.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct Shape {
+  TAGGED_UNION(Shape,
+	       (CIRCLE, double, radius),
+	       (SQUARE, double, side),
+	       (POINT, void, void))
+};
+
+struct Property {
+  TAGGED_UNION(Property,
+	       (DENSITY, float, density),
+	       (COUNT, int, count),
+	       (ENABLED, bool, enabled),
+	       (LABEL, std::string, label),
+	       (SHAPE, Shape, shape),
+	       (NONE, void, void))
+};
+
+// The name tables are usable at compile time
+static_assert(Property::type_names[Property::DENSITY] == "DENSITY");
+static_assert(Property::field_names[Property::SHAPE] == "shape");
+static_assert(Property::field_names[Property::NONE] == "");
+static_assert(Property::type_name(Property::LABEL) == "LABEL");
+
+template <typename T>
+std::string write(T const& value) {
+  char buffer[256];
+  auto const result = tagged_union::json::to_json(buffer, buffer + sizeof(buffer), value);
+  if (result.ec != std::errc())
+    return "<error>";
+  return std::string(buffer, result.ptr);
+}
+
+int check_round_trip(Property const& p, std::string const& expected) {
+  std::string const text = write(p);
+  std::cout << text << std::endl;
+  if (text != expected) {
+    std::cerr << "expected " << expected << std::endl;
+    return 1;
+  }
+  std::optional<Property> parsed;
+  auto const result = tagged_union::json::from_json(text.data(), text.data() + text.size(), parsed);
+  if (result.ec != std::errc() || result.ptr != text.data() + text.size() || !(*parsed == p)) {
+    std::cerr << "failed to parse back " << text << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main() {
+  if (check_round_trip(Property::create<Property::DENSITY>(1.5f), R"({"DENSITY":1.5})")
+      || check_round_trip(Property::create<Property::COUNT>(-42), R"({"COUNT":-42})")
+      || check_round_trip(Property::create<Property::ENABLED>(true), R"({"ENABLED":true})")
+      || check_round_trip(Property::create<Property::LABEL>(std::string("a \"quoted\"\n\x01")),
+			  R"({"LABEL":"a \"quoted\"\n\u0001"})")
+      || check_round_trip(Property::create<Property::SHAPE>(Shape::create<Shape::SQUARE>(2.0)),
+			  R"({"SHAPE":{"SQUARE":2}})")
+      || check_round_trip(Property::create<Property::SHAPE>(Shape::create<Shape::POINT>()),
+			  R"({"SHAPE":{"POINT":null}})")
+      || check_round_trip(Property::create<Property::NONE>(), R"({"NONE":null})"))
+    return 1;
+
+  // Whitespace and unicode escapes on input
+  std::string const spaced = " { \"LABEL\" :\t\"caf\\u00e9 \\ud83d\\ude00\" } ";
+  std::optional<Property> parsed;
+  auto result = tagged_union::json::from_json(spaced.data(), spaced.data() + spaced.size(), parsed);
+  if (result.ec != std::errc() || parsed->label() != "caf\xc3\xa9 \xf0\x9f\x98\x80")
+    return 1;
+
+  // Unknown tags, prefixes of tags, garbage, and numbers outside of the
+  // JSON grammar are all rejected
+  for (std::string const bad : {R"({"DENSITYY":1})", R"({"DENS":1})", R"({"COUNT":"1"})",
+				R"({"NONE":1})", R"({"COUNT":1)", R"({"NONE":null)", R"({"SHAPE":{"POINT":null})",
+				R"(["COUNT",1])",
+				R"({"DENSITY":nan})", R"({"DENSITY":inf})", R"({"DENSITY":-inf})",
+				R"({"DENSITY":1.})", R"({"DENSITY":.5})", R"({"DENSITY":01})",
+				R"({"DENSITY":-})", R"({"DENSITY":1e})", R"({"DENSITY":+1})",
+				R"({"COUNT":01})", R"({"COUNT":1.5})", R"({"COUNT":1e3})"}) {
+    std::optional<Property> out;
+    if (tagged_union::json::from_json(bad.data(), bad.data() + bad.size(), out).ec != std::errc::invalid_argument) {
+      std::cerr << "accepted " << bad << std::endl;
+      return 1;
+    }
+    if (out) {
+      std::cerr << "filled in a value from " << bad << std::endl;
+      return 1;
+    }
+  }
+
+  // Every part of the number grammar is still accepted
+  for (std::string const good : {R"({"DENSITY":-0.5e+1})", R"({"DENSITY":0})", R"({"DENSITY":25E-1})",
+				 R"({"COUNT":0})", R"({"COUNT":-10})"}) {
+    std::optional<Property> out;
+    if (tagged_union::json::from_json(good.data(), good.data() + good.size(), out).ec != std::errc()) {
+      std::cerr << "rejected " << good << std::endl;
+      return 1;
+    }
+  }
+
+  // Arrays stream in and out of a caller-provided buffer
+  std::vector<Property> properties;
+  for (int i = 0; i < 10; ++i)
+    properties.push_back(Property::create<Property::COUNT>(i));
+  properties.push_back(Property::create<Property::NONE>());
+  char buffer[512];
+  auto const written = tagged_union::json::to_json(buffer, buffer + sizeof(buffer), properties.begin(), properties.end());
+  if (written.ec != std::errc())
+    return 1;
+  std::vector<Property> read_back;
+  auto const read = tagged_union::json::from_json_array<Property>(buffer, written.ptr, [&](Property&& p) {
+    read_back.push_back(std::move(p));
+  });
+  if (read.ec != std::errc() || read_back.size() != properties.size())
+    return 1;
+  for (size_t i = 0; i < properties.size(); ++i)
+    if (!(read_back[i] == properties[i]))
+      return 1;
+
+  // Running out of room is reported rather than overflowing
+  char tiny[8];
+  if (tagged_union::json::to_json(tiny, tiny + sizeof(tiny), Property::create<Property::COUNT>(12345)).ec
+      != std::errc::value_too_large)
+    return 1;
+}
@@ -0,0 +1,136 @@
+#include <tagged_union/parallel.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct Sample {
+  TAGGED_UNION(Sample,
+	       (SMALL, int, small),
+	       (LARGE, int, large),
+	       (LABEL, std::string, label),
+	       (MISSING, void, void))
+};
+
+std::vector<Sample> make_samples(size_t n) {
+  std::vector<Sample> samples;
+  samples.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    switch (i % 4) {
+    case 0: samples.push_back(Sample::create<Sample::SMALL>(int(i))); break;
+    case 1: samples.push_back(Sample::create<Sample::LARGE>(int(i))); break;
+    case 2: samples.push_back(Sample::create<Sample::LABEL>(std::to_string(i))); break;
+    default: samples.push_back(Sample::create<Sample::MISSING>()); break;
+    }
+  }
+  return samples;
+}
+
+struct Reading {
+  TAGGED_UNION(Reading,
+	       (DENSITY, float, density),
+	       (COUNT, int, count),
+	       (NONE, void, void))
+};
+
+// A generic one-argument handler only ever sees payloads; void variants
+// go to the nullary overload instead of being handed their tag
+int check_generic(unsigned threads) {
+  namespace par = tagged_union::parallel;
+  std::vector<Reading> readings;
+  for (int i = 0; i < 1000; ++i) {
+    if (i % 3 == 0) readings.push_back(Reading::create<Reading::DENSITY>(0.5f));
+    else if (i % 3 == 1) readings.push_back(Reading::create<Reading::COUNT>(i));
+    else readings.push_back(Reading::create<Reading::NONE>());
+  }
+
+  auto const sums = par::reduce_by_type(par::policy{threads, 97}, readings, 0.0, std::plus<>(),
+					[](auto const& x) { return double(x); },
+					[]() { return -1.0; });
+  double expected_count = 0;
+  for (int i = 1; i < 1000; i += 3)
+    expected_count += i;
+  if (sums[Reading::DENSITY] != 334 * 0.5 || sums[Reading::COUNT] != expected_count
+      || sums[Reading::NONE] != -333) {
+    std::cerr << "generic overload mismatch with " << threads << " threads" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int check(size_t n, unsigned threads) {
+  namespace par = tagged_union::parallel;
+  par::policy const policy{threads, 97};
+  auto samples = make_samples(n);
+
+  // Same-typed variants need the tag to tell them apart
+  par::for_each_variant(policy, samples,
+			[](Sample::OfType<Sample::SMALL>, int& i) { i += 1; },
+			[](Sample::OfType<Sample::LARGE>, int& i) { i -= 1; },
+			[](std::string& s) { s += "!"; },
+			[]() {});
+
+  auto const counts = par::count_by_type(samples, policy);
+  auto const sums = par::reduce_by_type(policy, samples, size_t(0), std::plus<>(),
+					[](int i) { return size_t(i); },
+					[](std::string const& s) { return s.size(); },
+					[]() { return size_t(0); });
+
+  size_t expected_small = 0, expected_large = 0, expected_label = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (i % 4 == 0) expected_small += i + 1;
+    if (i % 4 == 1) expected_large += i - 1;
+    if (i % 4 == 2) expected_label += std::to_string(i).size() + 1;
+  }
+  if (sums[Sample::SMALL] != expected_small || sums[Sample::LARGE] != expected_large
+      || sums[Sample::LABEL] != expected_label) {
+    std::cerr << "reduce_by_type mismatch with " << threads << " threads" << std::endl;
+    return 1;
+  }
+  if (counts[Sample::MISSING] != n / 4) {
+    std::cerr << "count_by_type mismatch with " << threads << " threads" << std::endl;
+    return 1;
+  }
+
+  auto const middle = par::partition_by_type(samples, Sample::LABEL, policy);
+  if (size_t(middle - samples.begin()) != counts[Sample::LABEL]) {
+    std::cerr << "bad partition point with " << threads << " threads" << std::endl;
+    return 1;
+  }
+  // Stable: labels stay in ascending order, and so does everything else
+  for (auto it = samples.begin(); it != samples.end(); ++it) {
+    bool const front = it < middle;
+    if (front != (it->get_type() == Sample::LABEL)) {
+      std::cerr << "partition out of place with " << threads << " threads" << std::endl;
+      return 1;
+    }
+    if (front && it + 1 != middle
+	&& std::stoul((it + 1)->label()) < std::stoul(it->label())) {
+      std::cerr << "partition not stable with " << threads << " threads" << std::endl;
+      return 1;
+    }
+  }
+  long previous = -1;
+  for (auto it = middle; it != samples.end(); ++it) {
+    long original = previous;
+    if (it->get_type() == Sample::SMALL) original = it->small() - 1;
+    if (it->get_type() == Sample::LARGE) original = it->large() + 1;
+    if (original < previous) {
+      std::cerr << "partition not stable with " << threads << " threads" << std::endl;
+      return 1;
+    }
+    previous = original;
+  }
+  return 0;
+}
+
+int main() {
+  unsigned const max_threads = std::max(4u, std::thread::hardware_concurrency());
+  for (unsigned threads = 1; threads <= max_threads; ++threads) {
+    for (size_t n : {0, 1, 96, 97, 1000, 10007})
+      if (check(n, threads))
+	return 1;
+    if (check_generic(threads))
+      return 1;
+  }
+  std::cout << "ok up to " << max_threads << " threads" << std::endl;
+}